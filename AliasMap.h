@@ -0,0 +1,83 @@
+#pragma once
+
+#include "BlockOversampler.h"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+/** The lowest oversampling factor that keeps the aliasing of the waveshaper below kThreshold (dB relative to the signal), measured by
+ * tools/RCSinerAlias on a grid of the curve parameters and the drive, the input gain for full scale input, and written to AliasMapData.h.
+ * The measurement uses the Low Latency filters with pre and post clip off, other configurations get kUnmeasuredFactor.
+ * Quieter input aliases less, so input below full scale is covered. */
+namespace aliasmap
+{
+constexpr double kSyncs[] = {.5, 1., 2., 4., 8., 16.};
+constexpr double kPulls[] = {.25, .5, 1., 2., 4.};
+constexpr double kDeforms[] = {.25, .5, 1., 2., 4.};
+constexpr double kStages[] = {1., 2., 4., 8.};
+constexpr double kDrives[] = {0., 12., 24.}; // dB
+
+constexpr int kNumSyncs = static_cast<int>(std::size(kSyncs));
+constexpr int kNumPulls = static_cast<int>(std::size(kPulls));
+constexpr int kNumDeforms = static_cast<int>(std::size(kDeforms));
+constexpr int kNumStages = static_cast<int>(std::size(kStages));
+constexpr int kNumDrives = static_cast<int>(std::size(kDrives));
+constexpr int kNumPointsPerAlgorithm = kNumSyncs * kNumPulls * kNumDeforms * kNumStages * kNumDrives;
+constexpr iplug::EFactor kUnmeasuredFactor = iplug::EFactor::k16x; // the clips add harmonics and the FIR filters have other transition bands
+
+/** Position in the flattened grid, the drive varies fastest */
+constexpr int GetIndex(int algorithm, int sync, int pull, int deform, int stages, int drive)
+{
+  return (((((algorithm * kNumSyncs + sync) * kNumPulls + pull) * kNumDeforms + deform) * kNumStages + stages) * kNumDrives) + drive;
+}
+} // namespace aliasmap
+
+// The generator measures the grid above, it can't depend on its own output
+#ifndef ALIAS_MAP_GENERATOR
+#include "AliasMapData.h"
+
+namespace aliasmap
+{
+/** The grid points on both sides of value, the same point twice on a point or beyond the ends */
+template <size_t N>
+std::pair<int, int> GetNeighbours(const double (&axis)[N], double value)
+{
+  int upper = 0;
+  while (upper < static_cast<int>(N) - 1 && axis[upper] < value)
+    upper++;
+  if (value >= axis[upper] || upper == 0)
+    return {upper, upper};
+  return {upper - 1, upper};
+}
+
+/** Whether the map was measured for the filters and clips */
+constexpr bool IsMeasured(iplug::EFilterType filterType, bool preClip, bool postClip)
+{
+  return filterType == iplug::kHalfbandIIR && !preClip && !postClip;
+}
+
+/** The factor for a parameter set, between grid points the largest one of the surrounding points. driveDB is the input gain, at least 0 dB.
+ * Configurations the map doesn't cover get kUnmeasuredFactor. */
+inline iplug::EFactor GetRecommendedFactor(iplug::EFilterType filterType, bool preClip, bool postClip, int algorithm, double sync, double pull,
+                                           double deform, double stages, double driveDB)
+{
+  static_assert(std::size(kFactors) % kNumPointsPerAlgorithm == 0, "AliasMapData.h doesn't match the grid, run tools/RCSinerAlias --map");
+  if (!IsMeasured(filterType, preClip, postClip) || algorithm < 0 || algorithm >= static_cast<int>(std::size(kFactors)) / kNumPointsPerAlgorithm)
+    return kUnmeasuredFactor;
+
+  const auto syncs = GetNeighbours(kSyncs, sync);
+  const auto pulls = GetNeighbours(kPulls, pull);
+  const auto deforms = GetNeighbours(kDeforms, deform);
+  const auto stageses = GetNeighbours(kStages, stages);
+  const auto drives = GetNeighbours(kDrives, driveDB);
+  int factor = 0;
+  for (int s : {syncs.first, syncs.second})
+    for (int p : {pulls.first, pulls.second})
+      for (int d : {deforms.first, deforms.second})
+        for (int n : {stageses.first, stageses.second})
+          for (int g : {drives.first, drives.second})
+            factor = std::max<int>(factor, kFactors[GetIndex(algorithm, s, p, d, n, g)]);
+  return static_cast<iplug::EFactor>(factor);
+}
+} // namespace aliasmap
+#endif
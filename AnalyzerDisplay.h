@@ -0,0 +1,261 @@
+#pragma once
+
+#include "AnalyzerFeed.h"
+#include "FFT.h"
+#include "IControl.h"
+#include "IControls.h"
+#include "IGraphics.h"
+#include "IGraphicsStructs.h"
+#include "widgets/Color.h"
+#include "widgets/RCStyle.h"
+#include <cmath>
+
+BEGIN_IPLUG_NAMESPACE
+BEGIN_IGRAPHICS_NAMESPACE
+
+/** Oscilloscope or spectrum of the mono mixes of the input (filled, dimmed) and the output (line) delivered by an AnalyzerFeed.
+ * The audio thread only mixes and writes, the UI thread drains the ring once per frame and runs the FFT on the newest kFFTSize frames, so
+ * the analysis costs the same at any block size and sample rate. The scope triggers on the rising zero crossings of the input, the spectrum
+ * spans 20 Hz to Nyquist on a log scale with grid lines at 100 Hz, 1 kHz and 10 kHz and every 20 dB down from full scale, where a full scale
+ * sine peaks, and falls back by kSpectrumDecay per frame to keep short peaks visible. */
+class AnalyzerDisplay : public IControl
+{
+public:
+  enum EMode
+  {
+    kScope,
+    kSpectrum
+  };
+
+  static constexpr int kFFTOrder = 12;
+  static constexpr int kFFTSize = 1 << kFFTOrder;
+  static constexpr int kScopeFrames = 1024;
+  static constexpr float kMinFrequency = 20.f;
+  static constexpr float kMinDB = -120.f;
+  static constexpr float kSpectrumDecay = 1.5f; // dB per frame
+
+  AnalyzerDisplay(const IRECT& bounds, AnalyzerFeed& feed, const RCStyle& style = DEFAULT_RCSTYLE, float gridThickness = 1.f)
+    : IControl(bounds)
+    , mFeed(feed)
+    , mStyle(style)
+    , mGridThickness(gridThickness)
+    , mChunk(AnalyzerFeed::kCapacity)
+    , mPre(kFFTSize)
+    , mPost(kFFTSize)
+    , mWindow(kFFTSize)
+    , mFFT(kFFTOrder)
+    , mSpectra(kFFTSize)
+    , mPreDB(kFFTSize / 2 + 1, kMinDB)
+    , mPostDB(kFFTSize / 2 + 1, kMinDB)
+  {
+    for (int i = 0; i < kFFTSize; i++)
+      mWindow[i] = static_cast<float>(.5 - .5 * std::cos(2. * PI * i / kFFTSize));
+  }
+
+  void SetMode(EMode mode)
+  {
+    mMode = mode;
+    SetDirty(false);
+  }
+  EMode GetMode() const { return mMode; }
+
+  /** Starts from fresh audio when shown, whatever piled up in the ring meanwhile is stale */
+  void Hide(bool hide) override
+  {
+    if (!hide && IsHidden())
+    {
+      mFeed.GetRing().Discard();
+      std::fill(mPre.begin(), mPre.end(), 0.f);
+      std::fill(mPost.begin(), mPost.end(), 0.f);
+      std::fill(mPreDB.begin(), mPreDB.end(), kMinDB);
+      std::fill(mPostDB.begin(), mPostDB.end(), kMinDB);
+    }
+    IControl::Hide(hide);
+  }
+
+  /** Redraws whenever the audio thread delivered frames */
+  bool IsDirty() override
+  {
+    if (!IsHidden() && mFeed.GetRing().GetReadable())
+      SetDirty(false);
+    return IControl::IsDirty();
+  }
+
+  /** Right click triggers the action function, which switches the view */
+  void OnMouseDown(float x, float y, const IMouseMod& mod) override
+  {
+    if (mod.R)
+      SetDirty(true);
+  }
+
+  void Draw(IGraphics& g) override
+  {
+    const bool received = Drain();
+    auto colorset = mStyle.GetColors();
+    DrawBG(g, colorset);
+    if (mMode == kScope)
+      DrawScope(g, colorset);
+    else
+    {
+      if (received)
+        UpdateSpectrum();
+      DrawSpectrum(g, colorset);
+    }
+  }
+
+private:
+  AnalyzerFeed& mFeed;
+  RCStyle mStyle;
+  float mGridThickness;
+  EMode mMode = kScope;
+  std::vector<AnalyzerFeed::Frame> mChunk;
+  std::vector<float> mPre; // the newest kFFTSize frames, oldest first
+  std::vector<float> mPost;
+  std::vector<float> mWindow;
+  FFT<float> mFFT;
+  std::vector<std::complex<float>> mSpectra; // input and output, packed
+  std::vector<float> mPreDB; // per bin, 0 dB is a full scale sine
+  std::vector<float> mPostDB;
+
+  /** Appends everything in the ring to the history, returns whether there was anything */
+  bool Drain()
+  {
+    const int n = mFeed.GetRing().Read(mChunk.data(), static_cast<int>(mChunk.size()));
+    const int keep = std::max(kFFTSize - n, 0);
+    std::copy(mPre.end() - keep, mPre.end(), mPre.begin());
+    std::copy(mPost.end() - keep, mPost.end(), mPost.begin());
+    for (int i = std::max(n - kFFTSize, 0), s = keep; i < n; i++, s++)
+    {
+      mPre[s] = mChunk[i].pre;
+      mPost[s] = mChunk[i].post;
+    }
+    return n > 0;
+  }
+
+  void DrawBG(IGraphics& g, WidgetColorSet colorset)
+  {
+    if (mStyle.drawBG)
+      g.FillRect(colorset.GetBGColor(), mRECT.GetPadded(-(mStyle.frameThickness * .5f)), &mBlend);
+  }
+
+  IColor GetGridColor(WidgetColorSet colorset, bool major) const
+  {
+    const auto color = mStyle.drawBG || mStyle.drawFrame ? colorset.GetBorderColor() : colorset.GetColor();
+    return color.WithOpacity(major ? .75f : .36f);
+  }
+
+  void DrawScope(IGraphics& g, WidgetColorSet colorset)
+  {
+    const auto bounds = mRECT.GetPadded(-mStyle.frameThickness);
+    if (mGridThickness)
+    {
+      g.DrawHorizontalLine(GetGridColor(colorset, true), bounds, .5f, &mBlend, mGridThickness);
+      g.DrawHorizontalLine(GetGridColor(colorset, false), bounds, .25f, &mBlend, mGridThickness);
+      g.DrawHorizontalLine(GetGridColor(colorset, false), bounds, .75f, &mBlend, mGridThickness);
+    }
+
+    // The newest rising zero crossing of the input that leaves a whole window after it keeps periodic signals in place
+    int start = kFFTSize - kScopeFrames;
+    for (int s = start; s > kFFTSize - 2 * kScopeFrames; s--)
+    {
+      if (mPre[s - 1] < 0.f && mPre[s] >= 0.f)
+      {
+        start = s;
+        break;
+      }
+    }
+
+    const int w = std::max(static_cast<int>(bounds.W()), 1);
+    auto drawTrace = [&](const std::vector<float>& trace) {
+      // The extremes of the frames of every pixel column, so nothing between the columns gets lost
+      g.PathClear();
+      for (int x = 0; x < w; x++)
+      {
+        const int first = start + x * kScopeFrames / w;
+        const int last = std::max(start + (x + 1) * kScopeFrames / w, first + 1);
+        const auto range = std::minmax_element(trace.begin() + first, trace.begin() + last);
+        const float xPos = bounds.L + x + .5f;
+        const float yMax = bounds.MH() - bounds.H() * .5f * Clip(*range.second, -1.f, 1.f);
+        const float yMin = bounds.MH() - bounds.H() * .5f * Clip(*range.first, -1.f, 1.f);
+        if (x == 0)
+          g.PathMoveTo(xPos, yMax);
+        else
+          g.PathLineTo(xPos, yMax);
+        g.PathLineTo(xPos, yMin);
+      }
+    };
+    drawTrace(mPre);
+    g.PathStroke(colorset.GetColor().WithOpacity(.382f), 1.f, IStrokeOptions(), &mBlend);
+    drawTrace(mPost);
+    g.PathStroke(colorset.GetColor(), 1.f, IStrokeOptions(), &mBlend);
+  }
+
+  /** Both windowed signals go through one complex FFT, the input as the real and the output as the imaginary part */
+  void UpdateSpectrum()
+  {
+    for (int i = 0; i < kFFTSize; i++)
+      mSpectra[i] = std::complex<float>(mPre[i] * mWindow[i], mPost[i] * mWindow[i]);
+    mFFT.Transform(mSpectra.data());
+
+    // Hann has a coherent gain of 1/2, the single-sided spectrum doubles it back: a full scale sine lands on 0 dB
+    const float scale = 2.f / kFFTSize;
+    for (int k = 0; k <= kFFTSize / 2; k++)
+    {
+      const auto bins = mFFT.SplitReal(mSpectra.data(), k);
+      const float pre = std::abs(bins.first) * scale;
+      const float post = std::abs(bins.second) * scale;
+      mPreDB[k] = std::max(AmpToDBFloor(pre), mPreDB[k] - kSpectrumDecay);
+      mPostDB[k] = std::max(AmpToDBFloor(post), mPostDB[k] - kSpectrumDecay);
+    }
+  }
+
+  static float AmpToDBFloor(float amp) { return std::max(20.f * std::log10(std::max(amp, 1e-9f)), kMinDB); }
+
+  void DrawSpectrum(IGraphics& g, WidgetColorSet colorset)
+  {
+    const auto bounds = mRECT.GetPadded(-mStyle.frameThickness);
+    const float nyquist = static_cast<float>(mFeed.GetSampleRate() * .5);
+    const float octaves = std::log2(nyquist / kMinFrequency);
+    auto frequencyToX = [&](float frequency) { return bounds.L + bounds.W() * std::log2(frequency / kMinFrequency) / octaves; };
+    auto dbToY = [&](float db) { return bounds.T + bounds.H() * Clip(db / kMinDB, 0.f, 1.f); };
+
+    if (mGridThickness)
+    {
+      for (float frequency : {100.f, 1000.f, 10000.f})
+        if (frequency < nyquist)
+          g.DrawVerticalLine(GetGridColor(colorset, frequency == 1000.f), bounds, (frequencyToX(frequency) - bounds.L) / bounds.W(), &mBlend, mGridThickness);
+      for (float db = -20.f; db > kMinDB; db -= 20.f)
+        g.DrawHorizontalLine(GetGridColor(colorset, false), bounds, (dbToY(db) - bounds.T) / bounds.H(), &mBlend, mGridThickness);
+    }
+
+    // Every pixel column shows the loudest bin between its edges, or the nearest bin where the bins are wider than a pixel
+    const int w = std::max(static_cast<int>(bounds.W()), 1);
+    const float binsPerHz = kFFTSize / (2.f * nyquist);
+    auto buildPath = [&](const std::vector<float>& db, bool close) {
+      g.PathClear();
+      if (close)
+        g.PathMoveTo(bounds.L, bounds.B);
+      for (int x = 0; x < w; x++)
+      {
+        const float low = kMinFrequency * std::exp2(octaves * x / w) * binsPerHz;
+        const float high = kMinFrequency * std::exp2(octaves * (x + 1) / w) * binsPerHz;
+        const int first = std::min(static_cast<int>(std::lround(low)), kFFTSize / 2);
+        const int last = std::min(std::max(static_cast<int>(std::lround(high)), first + 1), kFFTSize / 2 + 1);
+        const float yPos = dbToY(*std::max_element(db.begin() + first, db.begin() + last));
+        if (x == 0 && !close)
+          g.PathMoveTo(bounds.L + x + .5f, yPos);
+        else
+          g.PathLineTo(bounds.L + x + .5f, yPos);
+      }
+      if (close)
+        g.PathLineTo(bounds.R, bounds.B);
+    };
+    buildPath(mPreDB, true);
+    g.PathFill(colorset.GetColor().WithOpacity(.382f), IFillOptions(true), &mBlend);
+    buildPath(mPostDB, false);
+    g.PathStroke(colorset.GetColor(), 1.f, IStrokeOptions(), &mBlend);
+  }
+};
+
+END_IGRAPHICS_NAMESPACE
+END_IPLUG_NAMESPACE
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "IPlugConstants.h"
+#include "SPSCRing.h"
+#include <atomic>
+#include <vector>
+
+/** Mono mixes of the input and the output of the audio thread for the AnalyzerDisplay, handed over in a wait-free SPSCRing. When the UI falls
+ * behind the newest frames are dropped, the audio thread never waits or allocates. Reset() belongs to the non-realtime thread that resets the
+ * plugin, CaptureInput() and PushOutput() to the audio thread, GetRing() to the UI thread. */
+class AnalyzerFeed
+{
+public:
+  struct Frame
+  {
+    float pre;
+    float post;
+  };
+
+  static constexpr int kCapacity = 1 << 15; // frames, about 0.7 s at 48 kHz
+
+  AnalyzerFeed()
+    : mRing(kCapacity)
+  {
+  }
+
+  /** Not realtime safe, blockSize is the largest nFrames passed to the audio thread calls */
+  void Reset(double sampleRate, int blockSize)
+  {
+    mSampleRate.store(sampleRate);
+    mFrames.resize(blockSize);
+  }
+
+  /** Before the block is processed, inputs and outputs may alias */
+  void CaptureInput(iplug::sample** inputs, int nFrames, int nChans) { Mix(inputs, nFrames, nChans, &Frame::pre); }
+
+  /** After the block passed to CaptureInput() is processed */
+  void PushOutput(iplug::sample** outputs, int nFrames, int nChans)
+  {
+    Mix(outputs, nFrames, nChans, &Frame::post);
+    mRing.Write(mFrames.data(), std::min(nFrames, static_cast<int>(mFrames.size())));
+  }
+
+  double GetSampleRate() const { return mSampleRate.load(); }
+  SPSCRing<Frame>& GetRing() { return mRing; }
+
+private:
+  void Mix(iplug::sample** channels, int nFrames, int nChans, float Frame::*member)
+  {
+    nFrames = std::min(nFrames, static_cast<int>(mFrames.size()));
+    const double gain = nChans ? 1. / nChans : 0.;
+    for (int s = 0; s < nFrames; s++)
+    {
+      double sum = 0.;
+      for (int c = 0; c < nChans; c++)
+        sum += channels[c][s];
+      mFrames[s].*member = static_cast<float>(sum * gain);
+    }
+  }
+
+  SPSCRing<Frame> mRing;
+  std::vector<Frame> mFrames; // the block being mixed
+  std::atomic<double> mSampleRate{DEFAULT_SAMPLE_RATE};
+};
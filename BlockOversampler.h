@@ -14,6 +14,8 @@
 
 #include <cmath>
 #include <functional>
+#include <type_traits>
+#include <vector>
 
 #include "HIIR/FPUDownsampler2x.h"
 #include "HIIR/FPUUpsampler2x.h"
@@ -21,6 +23,9 @@
 #include "heapbuf.h"
 #include "ptrlist.h"
 
+#include "Halfband2xSIMD.h"
+#include "HalfbandFIR.h"
+#include "IPlugConstants.h"
 #include "IPlugPlatform.h"
 
 BEGIN_IPLUG_NAMESPACE
@@ -37,72 +42,182 @@ enum EFactor
   kNumFactors
 };
 
+enum EFilterType
+{
+  kHalfbandIIR = 0, // hiir polyphase allpass cascade, low latency but not phase linear
+  kLinearPhaseFIR,  // linear phase, the latency is reported by GetLatency()
+  kNumFilterTypes
+};
+
+/** All channels of one 2x half-band stage. At construction the channels are grouped into vectorised filters (SSE2/NEON pairs, AVX2 quads when
+ * there are more than two channels, twice as many channels per group for float) when the CPU allows, otherwise one hiir FPU filter runs per channel.
+ * Mono always uses the FPU filter. */
+template <typename T, int NC, bool IsUp>
+class HalfbandBank
+{
+public:
+  using FPU = typename std::conditional<IsUp, Upsampler2xFPU<NC, T>, Downsampler2xFPU<NC, T>>::type;
+  template <typename V>
+  using Group = typename std::conditional<IsUp, simd::Upsampler2xSIMD<NC, V>, simd::Downsampler2xSIMD<NC, V>>::type;
+  static constexpr bool kVectorizable = std::is_same<T, double>::value || std::is_same<T, float>::value;
+
+  HalfbandBank() = default;
+  HalfbandBank(const HalfbandBank&) = delete;
+  HalfbandBank& operator=(const HalfbandBank&) = delete;
+  ~HalfbandBank() { mFPU.Empty(true); }
+
+  void Init(int nChannels, const double coefs[], bool allowSIMD)
+  {
+    const bool vectorize = kVectorizable && allowSIMD && nChannels > 1;
+#if defined SIMD_X86
+    if (vectorize && simd::GetLevel() == simd::ELevel::kAVX2 && nChannels > SSE2Group::kChannels)
+      InitGroups(mAVX2, nChannels, coefs);
+    else if (vectorize)
+      InitGroups(mSSE2, nChannels, coefs);
+#elif defined SIMD_NEON
+    if (vectorize)
+      InitGroups(mNEON, nChannels, coefs);
+#endif
+    if (!vectorize)
+    {
+      for (auto c = 0; c < nChannels; c++)
+      {
+        mFPU.Add(new FPU());
+        mFPU.Get(c)->set_coefs(coefs);
+      }
+    }
+  }
+
+  bool IsVectorized() const { return !mFPU.GetSize(); }
+
+  void Clear()
+  {
+    for (auto c = 0; c < mFPU.GetSize(); c++)
+      mFPU.Get(c)->clear_buffers();
+#if defined SIMD_X86
+    ClearGroups(mSSE2);
+    ClearGroups(mAVX2);
+#elif defined SIMD_NEON
+    ClearGroups(mNEON);
+#endif
+  }
+
+  /** n is the number of samples at the lower rate */
+  void ProcessBlock(T* const* outputs, T* const* inputs, long n, int nChans)
+  {
+    for (auto c = 0; c < nChans && c < mFPU.GetSize(); c++)
+      mFPU.Get(c)->process_block(outputs[c], inputs[c], n);
+#if defined SIMD_X86
+    ProcessGroups(mSSE2, outputs, inputs, n, nChans);
+    const int size = AVX2Group::kChannels;
+    for (size_t g = 0; g < mAVX2.size() && static_cast<int>(g) * size < nChans; g++)
+      ProcessAVX2(mAVX2[g], outputs + g * size, inputs + g * size, n, std::min(nChans - static_cast<int>(g) * size, size));
+#elif defined SIMD_NEON
+    ProcessGroups(mNEON, outputs, inputs, n, nChans);
+#endif
+  }
+
+private:
+  template <typename G>
+  void InitGroups(std::vector<G>& groups, int nChannels, const double coefs[])
+  {
+    groups.resize((nChannels + G::kChannels - 1) / G::kChannels);
+    for (auto& group : groups)
+    {
+      group.SetCoefs(coefs);
+      group.Clear();
+    }
+  }
+
+  template <typename G>
+  void ClearGroups(std::vector<G>& groups)
+  {
+    for (auto& group : groups)
+      group.Clear();
+  }
+
+  template <typename G>
+  void ProcessGroups(std::vector<G>& groups, T* const* outputs, T* const* inputs, long n, int nChans)
+  {
+    if constexpr (kVectorizable)
+    {
+      const int size = G::kChannels;
+      for (size_t g = 0; g < groups.size() && static_cast<int>(g) * size < nChans; g++)
+        groups[g].ProcessBlock(outputs + g * size, inputs + g * size, std::min(nChans - static_cast<int>(g) * size, size), n);
+    }
+  }
+
+  // Other sample types only ever use the FPU filters, double stands in for their vector types
+  using Vectors = simd::VectorTypes<typename std::conditional<kVectorizable, T, double>::type>;
+
+#if defined SIMD_X86
+  using SSE2Group = Group<typename Vectors::SSE2>;
+  using AVX2Group = Group<typename Vectors::AVX2>;
+
+  SIMD_TARGET_AVX2 SIMD_FLATTEN static void ProcessAVX2(AVX2Group& group, T* const* outputs, T* const* inputs, long n, int nChans)
+  {
+    if constexpr (kVectorizable)
+      group.ProcessBlock(outputs, inputs, nChans, n);
+  }
+
+  std::vector<SSE2Group> mSSE2;
+  std::vector<AVX2Group> mAVX2;
+#elif defined SIMD_NEON
+  std::vector<Group<typename Vectors::NEON>> mNEON;
+#endif
+  WDL_PtrList<FPU> mFPU;
+};
+
 template <typename T = double>
 class BlockOverSampler
 {
 public:
   using BlockProcessFunc = std::function<void(T**, T**, int)>;
 
-  BlockOverSampler(EFactor factor = kNone, int nInChannels = 1, int nOutChannels = 1, int blocksize = DEFAULT_BLOCK_SIZE)
+  /** allowSIMD selects vectorised half-band filters for multichannel use when the CPU supports them */
+  BlockOverSampler(EFactor factor = kNone, int nInChannels = 1, int nOutChannels = 1, int blocksize = DEFAULT_BLOCK_SIZE, bool allowSIMD = true, EFilterType filterType = kHalfbandIIR)
     : mNInChannels(nInChannels)
     , mNOutChannels(nOutChannels)
     , mBlockSize(blocksize)
   {
 
-    static constexpr double coeffs2x[12] = {0.036681502163648017, 0.13654762463195794, 0.27463175937945444, 0.42313861743656711, 0.56109869787919531, 0.67754004997416184,
-                                            0.76974183386322703,  0.83988962484963892, 0.89226081800387902, 0.9315419599631839,  0.96209454837808417, 0.98781637073289585};
-    static constexpr double coeffs4x[4] = {0.041893991997656171, 0.16890348243995201, 0.39056077292116603, 0.74389574826847926};
-    static constexpr double coeffs8x[3] = {0.055748680811302048, 0.24305119574153072, 0.64669913119268196};
-    static constexpr double coeffs16x[2] = {0.10717745346023573, 0.53091435354504557};
-
+    mUpsampler2x.Init(mNInChannels, kCoeffs2x, allowSIMD);
+    mUpsampler4x.Init(mNInChannels, kCoeffs4x, allowSIMD);
+    mUpsampler8x.Init(mNInChannels, kCoeffs8x, allowSIMD);
+    mUpsampler16x.Init(mNInChannels, kCoeffs16x, allowSIMD);
+    for (auto stage = 0; stage < kNumStages; stage++)
+    {
+      mFIRUpsamplers[stage].resize(mNInChannels);
+      for (auto& fir : mFIRUpsamplers[stage])
+        fir.Design(kFIRHalfLengths[stage]);
+    }
     for (auto c = 0; c < mNInChannels; c++)
     {
-      mUpsampler2x.Add(new Upsampler2xFPU<12, T>());
-      mUpsampler4x.Add(new Upsampler2xFPU<4, T>());
-      mUpsampler8x.Add(new Upsampler2xFPU<3, T>());
-      mUpsampler16x.Add(new Upsampler2xFPU<2, T>());
-
-      mUpsampler2x.Get(c)->set_coefs(coeffs2x);
-      mUpsampler4x.Get(c)->set_coefs(coeffs4x);
-      mUpsampler8x.Get(c)->set_coefs(coeffs8x);
-      mUpsampler16x.Get(c)->set_coefs(coeffs16x);
-
       // ptr location doesn't matter at this stage
       mNextInputPtrs.Add(mUp2x.Get());
     }
 
+    mDownsampler2x.Init(mNOutChannels, kCoeffs2x, allowSIMD);
+    mDownsampler4x.Init(mNOutChannels, kCoeffs4x, allowSIMD);
+    mDownsampler8x.Init(mNOutChannels, kCoeffs8x, allowSIMD);
+    mDownsampler16x.Init(mNOutChannels, kCoeffs16x, allowSIMD);
+    for (auto stage = 0; stage < kNumStages; stage++)
+    {
+      mFIRDownsamplers[stage].resize(mNOutChannels);
+      for (auto& fir : mFIRDownsamplers[stage])
+        fir.Design(kFIRHalfLengths[stage]);
+    }
     for (auto c = 0; c < mNOutChannels; c++)
     {
-      mDownsampler2x.Add(new Downsampler2xFPU<12, T>());
-      mDownsampler4x.Add(new Downsampler2xFPU<4, T>());
-      mDownsampler8x.Add(new Downsampler2xFPU<3, T>());
-      mDownsampler16x.Add(new Downsampler2xFPU<2, T>());
-
-      mDownsampler2x.Get(c)->set_coefs(coeffs2x);
-      mDownsampler4x.Get(c)->set_coefs(coeffs4x);
-      mDownsampler8x.Get(c)->set_coefs(coeffs8x);
-      mDownsampler16x.Get(c)->set_coefs(coeffs16x);
-
       // ptr location doesn't matter at this stage
       mNextOutputPtrs.Add(mDown2x.Get());
     }
 
+    mFilterType = filterType;
     SetOverSampling(factor);
     Reset();
   }
 
-  ~BlockOverSampler()
-  {
-    mUpsampler2x.Empty(true);
-    mDownsampler2x.Empty(true);
-    mUpsampler4x.Empty(true);
-    mDownsampler4x.Empty(true);
-    mUpsampler8x.Empty(true);
-    mDownsampler8x.Empty(true);
-    mUpsampler16x.Empty(true);
-    mDownsampler16x.Empty(true);
-  }
-
   BlockOverSampler(const BlockOverSampler&) = delete;
   BlockOverSampler& operator=(const BlockOverSampler&) = delete;
 
@@ -131,13 +246,9 @@ public:
     mDown4BufferPtrs.Empty();
     mDown2BufferPtrs.Empty();
 
+    Clear();
     for (auto c = 0; c < mNInChannels; c++)
     {
-      mUpsampler2x.Get(c)->clear_buffers();
-      mUpsampler4x.Get(c)->clear_buffers();
-      mUpsampler8x.Get(c)->clear_buffers();
-      mUpsampler16x.Get(c)->clear_buffers();
-
       mUp2BufferPtrs.Add(mUp2x.Get() + c * 2 * mBlockSize);
       mUp4BufferPtrs.Add(mUp4x.Get() + (c * 4 * mBlockSize));
       mUp8BufferPtrs.Add(mUp8x.Get() + (c * 8 * mBlockSize));
@@ -146,11 +257,6 @@ public:
 
     for (auto c = 0; c < mNOutChannels; c++)
     {
-      mDownsampler2x.Get(c)->clear_buffers();
-      mDownsampler4x.Get(c)->clear_buffers();
-      mDownsampler8x.Get(c)->clear_buffers();
-      mDownsampler16x.Get(c)->clear_buffers();
-
       mDown2BufferPtrs.Add(mDown2x.Get() + c * 2 * mBlockSize);
       mDown4BufferPtrs.Add(mDown4x.Get() + (c * 4 * mBlockSize));
       mDown8BufferPtrs.Add(mDown8x.Get() + (c * 8 * mBlockSize));
@@ -158,14 +264,38 @@ public:
     }
   }
 
+  /** Clears the filter states only, unlike Reset() realtime safe */
+  void Clear()
+  {
+    ClearIIRs();
+    ClearFIRs();
+  }
+
   /** Over sample an input block with a per-block function (up sample input -> process with function -> down sample)
    * @param inputs Two-dimensional array containing the non-interleaved input buffers of audio samples for all channels
    * @param outputs Two-dimensional array for audio output (non-interleaved).
    * @param nFrames The block size for this block: number of samples per channel.
    * @param nInChans The number of input channels to process. Must be less or equal to the number of channels passed to the constructor
    * @param nOutChans The number of output channels to process. Must be less or equal to the number of channels passed to the constructor
-   * @param func The function that processes the audio sample at the higher sampling rate. NOTE: std::function can call malloc if you pass in captures */
+   * @param func The function that processes the audio sample at the higher sampling rate. NOTE: std::function can call malloc if you pass in captures,
+   * passing a lambda directly selects the template overload below, which is inlined and never allocates */
   void ProcessBlock(T** inputs, T** outputs, int nFrames, int nInChans, int nOutChans, BlockProcessFunc func)
+  {
+    ProcessBlock<BlockProcessFunc&>(inputs, outputs, nFrames, nInChans, nOutChans, func);
+  }
+
+  /** Same as above for any callable with the signature of BlockProcessFunc, which is called without type erasure */
+  template <typename F>
+  void ProcessBlock(T** inputs, T** outputs, int nFrames, int nInChans, int nOutChans, F&& func)
+  {
+    ProcessBlock(inputs, outputs, nFrames, nInChans, nOutChans, func, nullptr, 0, [](int) {});
+  }
+
+  /** Same as above with the block divided at the frame offsets in splits, which must be ascending and inside the block. atSplit(i) is called between
+   * the processing of the samples before and after splits[i], at the higher rate the split falls on the first of the rate samples made from that frame.
+   * The block is resampled in one go, only func is called per segment. */
+  template <typename F, typename G>
+  void ProcessBlock(T** inputs, T** outputs, int nFrames, int nInChans, int nOutChans, F&& func, const int* splits, int nSplits, G&& atSplit)
   {
     assert(nInChans <= mNInChannels);
     assert(nOutChans <= mNOutChannels);
@@ -197,61 +327,60 @@ public:
       mPrevRate = mRate;
     }
 
-    for (auto c = 0; c < nInChans; c++)
+    if (mFilterType == kLinearPhaseFIR)
+      UpsampleFIR(inputs, nFrames, nInChans);
+    else
     {
       if (mRate >= 2)
-      {
-        mUpsampler2x.Get(c)->process_block(mUp2BufferPtrs.Get(c), inputs[c], nFrames);
-      }
+        mUpsampler2x.ProcessBlock(mUp2BufferPtrs.GetList(), inputs, nFrames, nInChans);
       if (mRate >= 4)
-      {
-        mUpsampler4x.Get(c)->process_block(mUp4BufferPtrs.Get(c), mUp2BufferPtrs.Get(c), nFrames * 2);
-      }
+        mUpsampler4x.ProcessBlock(mUp4BufferPtrs.GetList(), mUp2BufferPtrs.GetList(), nFrames * 2, nInChans);
       if (mRate >= 8)
-      {
-        mUpsampler8x.Get(c)->process_block(mUp8BufferPtrs.Get(c), mUp4BufferPtrs.Get(c), nFrames * 4);
-      }
+        mUpsampler8x.ProcessBlock(mUp8BufferPtrs.GetList(), mUp4BufferPtrs.GetList(), nFrames * 4, nInChans);
       if (mRate == 16)
-      {
-        mUpsampler16x.Get(c)->process_block(mUp16BufferPtrs.Get(c), mUp8BufferPtrs.Get(c), nFrames * 8);
-      }
+        mUpsampler16x.ProcessBlock(mUp16BufferPtrs.GetList(), mUp8BufferPtrs.GetList(), nFrames * 8, nInChans);
     }
 
-    if (mRate == 1)
+    if (mRate == 1 && !nSplits)
     {
       func(inputs, outputs, nFrames);
     }
     else
     {
-      for (auto i = 0; i < mRate; i++)
+      T* const* osInputs = mRate == 1 ? inputs : mInPtrLoopSrc->GetList();
+      T* const* osOutputs = mRate == 1 ? outputs : mOutPtrLoopSrc->GetList();
+      int start = 0;
+      for (auto split = 0; split <= nSplits; split++)
       {
-        for (auto c = 0; c < nInChans; c++)
+        const int end = (split < nSplits ? splits[split] : nFrames) * mRate;
+        assert(end >= start && end <= nFrames * mRate);
+        // func never gets more than nFrames samples at a time, the size its buffers are made for
+        for (auto pos = start; pos < end; pos += nFrames)
         {
-          mNextInputPtrs.Set(c, mInPtrLoopSrc->Get(c) + (i * nFrames));
-          mNextOutputPtrs.Set(c, mOutPtrLoopSrc->Get(c) + (i * nFrames));
+          for (auto c = 0; c < nInChans; c++)
+            mNextInputPtrs.Set(c, osInputs[c] + pos);
+          for (auto c = 0; c < nOutChans; c++)
+            mNextOutputPtrs.Set(c, osOutputs[c] + pos);
+          func(mNextInputPtrs.GetList(), mNextOutputPtrs.GetList(), std::min(nFrames, end - pos));
         }
-        func(mNextInputPtrs.GetList(), mNextOutputPtrs.GetList(), nFrames);
+        if (split < nSplits)
+          atSplit(split);
+        start = end;
       }
     }
 
-    for (auto c = 0; c < nOutChans; c++)
+    if (mFilterType == kLinearPhaseFIR)
+      DownsampleFIR(outputs, nFrames, nOutChans);
+    else
     {
       if (mRate == 16)
-      {
-        mDownsampler16x.Get(c)->process_block(mDown8BufferPtrs.Get(c), mDown16BufferPtrs.Get(c), nFrames * 8);
-      }
+        mDownsampler16x.ProcessBlock(mDown8BufferPtrs.GetList(), mDown16BufferPtrs.GetList(), nFrames * 8, nOutChans);
       if (mRate >= 8)
-      {
-        mDownsampler8x.Get(c)->process_block(mDown4BufferPtrs.Get(c), mDown8BufferPtrs.Get(c), nFrames * 4);
-      }
+        mDownsampler8x.ProcessBlock(mDown4BufferPtrs.GetList(), mDown8BufferPtrs.GetList(), nFrames * 4, nOutChans);
       if (mRate >= 4)
-      {
-        mDownsampler4x.Get(c)->process_block(mDown2BufferPtrs.Get(c), mDown4BufferPtrs.Get(c), nFrames * 2);
-      }
+        mDownsampler4x.ProcessBlock(mDown2BufferPtrs.GetList(), mDown4BufferPtrs.GetList(), nFrames * 2, nOutChans);
       if (mRate >= 2)
-      {
-        mDownsampler2x.Get(c)->process_block(outputs[c], mDown2BufferPtrs.Get(c), nFrames);
-      }
+        mDownsampler2x.ProcessBlock(outputs, mDown2BufferPtrs.GetList(), nFrames, nOutChans);
     }
   }
 
@@ -261,9 +390,71 @@ public:
     {
       mFactor = factor;
       mRate = std::pow(2, (int)factor);
+      // Only the first decimator after the processing carries the padding delay of the cascade
+      const int padding = GetFIRPadding(factor);
+      for (auto stage = 0; stage < kNumStages; stage++)
+        for (auto& fir : mFIRDownsamplers[stage])
+          fir.SetDelay(stage + 1 == static_cast<int>(factor) ? padding : 0);
+    }
+  }
+
+  /** Switches between the IIR and linear phase filters, clearing the state of the new filters. Realtime safe. */
+  void SetFilterType(EFilterType filterType)
+  {
+    if (filterType != mFilterType)
+    {
+      mFilterType = filterType;
+      if (filterType == kLinearPhaseFIR)
+        ClearFIRs();
+      else
+        ClearIIRs();
+    }
+  }
+
+  EFilterType GetFilterType() const { return mFilterType; }
+
+  /** The delay in samples at the original rate introduced by up and down sampling, rounded to whole samples for the IIR filters, whose group delay
+   * depends on the frequency; this is their delay at low frequencies. The linear phase filters delay every frequency by exactly this amount. */
+  static int GetLatency(EFactor factor, EFilterType filterType)
+  {
+    const int nStages = static_cast<int>(factor);
+    if (filterType == kLinearPhaseFIR)
+      return (GetFIRDelay(factor) + GetFIRPadding(factor)) >> nStages;
+
+    // Each 2x stage delays by its allpass delays at DC, averaged over the two paths, once up and once down
+    double latency = 0.;
+    for (auto stage = 0; stage < nStages; stage++)
+    {
+      double stageDelay = .5;
+      for (auto i = 0; i < kNumCoeffs[stage]; i++)
+        stageDelay += (1. - kCoeffs[stage][i]) / (1. + kCoeffs[stage][i]);
+      latency += (2. * stageDelay - 1.) / (2 << stage);
     }
+    return static_cast<int>(std::round(latency));
+  }
+
+  int GetLatency() const { return GetLatency(mFactor, mFilterType); }
+
+  /** The number of samples at the original rate the output takes to fall below threshold (linear, relative to full scale) once the input is silent.
+   * The linear phase filters stop after twice their latency. The IIR filters never stop, they ring for about as long as the allpass with the largest
+   * coefficient of each stage, whose pole lies closest to the unit circle, takes to decay to threshold. */
+  static int GetTailSize(EFactor factor, EFilterType filterType, double threshold)
+  {
+    assert(threshold > 0.);
+    const int nStages = static_cast<int>(factor);
+    if (!nStages)
+      return 0;
+    if (filterType == kLinearPhaseFIR)
+      return 2 * GetLatency(factor, filterType) + 1;
+
+    double tail = GetLatency(factor, filterType);
+    for (auto stage = 0; stage < nStages; stage++)
+      tail += std::log(threshold) / std::log(kCoeffs[stage][kNumCoeffs[stage] - 1]) / (1 << stage);
+    return static_cast<int>(std::ceil(tail));
   }
 
+  int GetTailSize(double threshold) const { return GetTailSize(mFactor, mFilterType, threshold); }
+
   void SetBlockSize(int blocksize = DEFAULT_BLOCK_SIZE)
   {
     if (mBlockSize != blocksize)
@@ -297,7 +488,76 @@ public:
   int GetRate() const { return mRate; }
 
 private:
+  static constexpr int kNumStages = 4;
+  static constexpr double kCoeffs2x[12] = {0.036681502163648017, 0.13654762463195794, 0.27463175937945444, 0.42313861743656711, 0.56109869787919531, 0.67754004997416184,
+                                           0.76974183386322703,  0.83988962484963892, 0.89226081800387902, 0.9315419599631839,  0.96209454837808417, 0.98781637073289585};
+  static constexpr double kCoeffs4x[4] = {0.041893991997656171, 0.16890348243995201, 0.39056077292116603, 0.74389574826847926};
+  static constexpr double kCoeffs8x[3] = {0.055748680811302048, 0.24305119574153072, 0.64669913119268196};
+  static constexpr double kCoeffs16x[2] = {0.10717745346023573, 0.53091435354504557};
+  // In ascending order
+  static constexpr const double* kCoeffs[kNumStages] = {kCoeffs2x, kCoeffs4x, kCoeffs8x, kCoeffs16x};
+  static constexpr int kNumCoeffs[kNumStages] = {12, 4, 3, 2};
+  // The later stages only have to keep their images away from the audio band and get away with much shorter filters
+  static constexpr int kFIRHalfLengths[kNumStages] = {32, 8, 6, 5};
+
+  /** The delay of the linear phase cascade in samples at the highest rate, every stage delays once up and once down */
+  static int GetFIRDelay(EFactor factor)
+  {
+    const int nStages = static_cast<int>(factor);
+    int delay = 0;
+    for (auto stage = 0; stage < nStages; stage++)
+      delay += (2 * (2 * kFIRHalfLengths[stage] - 1)) << (nStages - stage - 1);
+    return delay;
+  }
+
+  /** The extra delay at the highest rate that rounds the latency of the linear phase cascade to whole samples */
+  static int GetFIRPadding(EFactor factor)
+  {
+    const int rate = 1 << static_cast<int>(factor);
+    return (rate - GetFIRDelay(factor) % rate) % rate;
+  }
+
+  void ClearIIRs()
+  {
+    mUpsampler2x.Clear();
+    mUpsampler4x.Clear();
+    mUpsampler8x.Clear();
+    mUpsampler16x.Clear();
+    mDownsampler2x.Clear();
+    mDownsampler4x.Clear();
+    mDownsampler8x.Clear();
+    mDownsampler16x.Clear();
+  }
+
+  void ClearFIRs()
+  {
+    for (auto stage = 0; stage < kNumStages; stage++)
+    {
+      for (auto& fir : mFIRUpsamplers[stage])
+        fir.Clear();
+      for (auto& fir : mFIRDownsamplers[stage])
+        fir.Clear();
+    }
+  }
+
+  void UpsampleFIR(T** inputs, int nFrames, int nChans)
+  {
+    WDL_PtrList<T>* buffers[kNumStages] = {&mUp2BufferPtrs, &mUp4BufferPtrs, &mUp8BufferPtrs, &mUp16BufferPtrs};
+    for (auto stage = 0; stage < static_cast<int>(mFactor); stage++)
+      for (auto c = 0; c < nChans; c++)
+        mFIRUpsamplers[stage][c].ProcessBlock(buffers[stage]->Get(c), stage ? buffers[stage - 1]->Get(c) : inputs[c], nFrames << stage);
+  }
+
+  void DownsampleFIR(T** outputs, int nFrames, int nChans)
+  {
+    WDL_PtrList<T>* buffers[kNumStages] = {&mDown2BufferPtrs, &mDown4BufferPtrs, &mDown8BufferPtrs, &mDown16BufferPtrs};
+    for (auto stage = static_cast<int>(mFactor) - 1; stage >= 0; stage--)
+      for (auto c = 0; c < nChans; c++)
+        mFIRDownsamplers[stage][c].ProcessBlock(stage ? buffers[stage - 1]->Get(c) : outputs[c], buffers[stage]->Get(c), nFrames << stage);
+  }
+
   EFactor mFactor = kNone;
+  EFilterType mFilterType = kHalfbandIIR;
   int mPrevRate = 0;
   int mRate = 1;
   int mWritePos = 0;
@@ -335,16 +595,20 @@ private:
   WDL_PtrList<T>* mInPtrLoopSrc = nullptr;
   WDL_PtrList<T>* mOutPtrLoopSrc = nullptr;
 
-  // Ptrs to oversamplers for each channel
-  WDL_PtrList<Upsampler2xFPU<12, T>> mUpsampler2x; // for 1x to 2x SR
-  WDL_PtrList<Upsampler2xFPU<4, T>> mUpsampler4x;  // for 2x to 4x SR
-  WDL_PtrList<Upsampler2xFPU<3, T>> mUpsampler8x;  // for 4x to 8x SR
-  WDL_PtrList<Upsampler2xFPU<2, T>> mUpsampler16x; // for 8x to 16x SR
+  // Oversamplers for all channels
+  HalfbandBank<T, 12, true> mUpsampler2x; // for 1x to 2x SR
+  HalfbandBank<T, 4, true> mUpsampler4x;  // for 2x to 4x SR
+  HalfbandBank<T, 3, true> mUpsampler8x;  // for 4x to 8x SR
+  HalfbandBank<T, 2, true> mUpsampler16x; // for 8x to 16x SR
+
+  HalfbandBank<T, 12, false> mDownsampler2x; // decimator for 2x to 1x SR
+  HalfbandBank<T, 4, false> mDownsampler4x;  // decimator for 4x to 2x SR
+  HalfbandBank<T, 3, false> mDownsampler8x;  // decimator for 8x to 4x SR
+  HalfbandBank<T, 2, false> mDownsampler16x; // decimator for 16x to 8x SR
 
-  WDL_PtrList<Downsampler2xFPU<12, T>> mDownsampler2x; // decimator for 2x to 1x SR
-  WDL_PtrList<Downsampler2xFPU<4, T>> mDownsampler4x;  // decimator for 4x to 2x SR
-  WDL_PtrList<Downsampler2xFPU<3, T>> mDownsampler8x;  // decimator for 8x to 4x SR
-  WDL_PtrList<Downsampler2xFPU<2, T>> mDownsampler16x; // decimator for 16x to 8x SR
+  // Linear phase filters for all channels, per stage from 2x to 16x
+  std::vector<Upsampler2xFIR<T>> mFIRUpsamplers[kNumStages];
+  std::vector<Downsampler2xFIR<T>> mFIRDownsamplers[kNumStages];
 };
 
 END_IPLUG_NAMESPACE
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cmath>
+#include <complex>
+#include <utility>
+#include <vector>
+
+/** In-place radix-2 complex FFT of a fixed power of two size, the tables are built at construction. Two real signals of the same length go
+ * through one transform as the real and imaginary parts, SplitReal() separates their spectra again. */
+template <typename T>
+class FFT
+{
+public:
+  explicit FFT(int order)
+    : mSize(1 << order)
+    , mTwiddles(mSize / 2)
+    , mBitReverse(mSize)
+  {
+    for (int i = 0; i < mSize; i++)
+    {
+      int reversed = 0;
+      for (int bit = 0; bit < order; bit++)
+        reversed |= ((i >> bit) & 1) << (order - 1 - bit);
+      mBitReverse[i] = reversed;
+    }
+    const double pi = std::acos(-1.);
+    for (int k = 0; k < mSize / 2; k++)
+      mTwiddles[k] = std::polar(static_cast<T>(1), static_cast<T>(-2. * pi * k / mSize));
+  }
+
+  int GetSize() const { return mSize; }
+
+  /** Forward transform of GetSize() values, unscaled */
+  void Transform(std::complex<T>* data) const
+  {
+    for (int i = 0; i < mSize; i++)
+      if (i < mBitReverse[i])
+        std::swap(data[i], data[mBitReverse[i]]);
+    for (int size = 2; size <= mSize; size *= 2)
+    {
+      const int half = size / 2;
+      const int step = mSize / size;
+      for (int begin = 0; begin < mSize; begin += size)
+      {
+        for (int k = 0; k < half; k++)
+        {
+          const auto t = mTwiddles[k * step] * data[begin + k + half];
+          data[begin + k + half] = data[begin + k] - t;
+          data[begin + k] += t;
+        }
+      }
+    }
+  }
+
+  /** Bin k of the spectra of the real and the imaginary input of a transformed data, times two */
+  std::pair<std::complex<T>, std::complex<T>> SplitReal(const std::complex<T>* data, int k) const
+  {
+    const auto z = data[k];
+    const auto zMirror = std::conj(data[(mSize - k) & (mSize - 1)]);
+    return {z + zMirror, std::complex<T>(0, -1) * (z - zMirror)};
+  }
+
+private:
+  int mSize;
+  std::vector<std::complex<T>> mTwiddles;
+  std::vector<int> mBitReverse;
+};
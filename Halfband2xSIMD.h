@@ -0,0 +1,257 @@
+#pragma once
+
+#include <algorithm>
+
+#include "SIMD.h"
+
+BEGIN_IPLUG_NAMESPACE
+namespace simd
+{
+// One sample through the HIIR allpass cascade, path 0 takes the even coefficients and path 1 the odd ones
+template <int NC, typename V>
+inline void ProcessHalfbandStages(const V* coefs, V* x, V* y, V& spl0, V& spl1)
+{
+  for (int i = 0; i + 1 < NC; i += 2)
+  {
+    const V tmp0 = (spl0 - y[i]) * coefs[i] + x[i];
+    const V tmp1 = (spl1 - y[i + 1]) * coefs[i + 1] + x[i + 1];
+    x[i] = spl0;
+    x[i + 1] = spl1;
+    y[i] = tmp0;
+    y[i + 1] = tmp1;
+    spl0 = tmp0;
+    spl1 = tmp1;
+  }
+  if (NC & 1)
+  {
+    const V tmp0 = (spl0 - y[NC - 1]) * coefs[NC - 1] + x[NC - 1];
+    x[NC - 1] = spl0;
+    y[NC - 1] = tmp0;
+    spl0 = tmp0;
+  }
+}
+
+/** Base of the vectorised HIIR half-band filters, V::kSize channels are processed at once with one channel per lane.
+ * A single channel is a serial chain of dependent operations, running several channels side by side keeps the pipeline busy.
+ * The arithmetic is the one of hiir::Upsampler2xFPU/Downsampler2xFPU of the same sample type, so results match them to the last bit where no FMA is contracted. */
+template <int NC, typename V>
+class Halfband2xSIMD
+{
+public:
+  using Scalar = typename V::Scalar;
+  static constexpr int kChannels = V::kSize;
+
+  void SetCoefs(const double coefs[])
+  {
+    for (int i = 0; i < NC; i++)
+      mCoefs[i] = static_cast<Scalar>(coefs[i]);
+  }
+
+  void Clear()
+  {
+    for (int i = 0; i < NC * kChannels; i++)
+      mX[i] = mY[i] = 0.;
+  }
+
+protected:
+  // Vectors of more than two lanes are gathered and scattered a chunk at a time, the compiler only builds two lanes in registers and
+  // goes through memory for more, where a vector load right after the scalar stores to its lanes stalls on the store forwarding
+  static constexpr bool kChunked = kChannels > 2;
+  static constexpr int kChunkSize = 64;
+
+  struct State
+  {
+    V coefs[NC];
+    V x[NC];
+    V y[NC];
+  };
+
+  void Load(State& state) const
+  {
+    for (int i = 0; i < NC; i++)
+    {
+      state.coefs[i] = V::Set(mCoefs[i]);
+      state.x[i] = V::Load(mX + i * kChannels);
+      state.y[i] = V::Load(mY + i * kChannels);
+    }
+  }
+
+  void Store(const State& state)
+  {
+    for (int i = 0; i < NC; i++)
+    {
+      state.x[i].Store(mX + i * kChannels);
+      state.y[i].Store(mY + i * kChannels);
+    }
+  }
+
+  Scalar mCoefs[NC] = {};
+  Scalar mX[NC * kChannels] = {};
+  Scalar mY[NC * kChannels] = {};
+};
+
+/** Vectorised counterpart of hiir::Upsampler2xFPU */
+template <int NC, typename V>
+class Upsampler2xSIMD : public Halfband2xSIMD<NC, V>
+{
+public:
+  using Base = Halfband2xSIMD<NC, V>;
+  using Scalar = typename Base::Scalar;
+  static constexpr int kChannels = Base::kChannels;
+
+  /** Upsamples n samples of nChans <= kChannels channels, out[c] receives 2n samples */
+  void ProcessBlock(Scalar* const out[], const Scalar* const in[], int nChans, long n) { Dispatch<kChannels>(out, in, nChans, n); }
+
+private:
+  // The channel count is made a constant so the lane gathering unrolls into registers instead of going through memory
+  template <int N>
+  void Dispatch(Scalar* const out[], const Scalar* const in[], int nChans, long n)
+  {
+    if constexpr (N > 1)
+    {
+      if (nChans < N)
+        return Dispatch<N - 1>(out, in, nChans, n);
+    }
+    Process<N>(out, in, n);
+  }
+
+  template <int N>
+  void Process(Scalar* const out[], const Scalar* const in[], long n)
+  {
+    typename Base::State state;
+    Base::Load(state);
+    if constexpr (Base::kChunked)
+    {
+      constexpr int size = Base::kChunkSize;
+      Scalar lanes[size * kChannels] = {};
+      Scalar even[size * kChannels];
+      Scalar odd[size * kChannels];
+      for (long pos = 0; pos < n; pos += size)
+      {
+        const int chunk = static_cast<int>(std::min<long>(size, n - pos));
+        for (int c = 0; c < N; c++)
+          for (int p = 0; p < chunk; p++)
+            lanes[p * kChannels + c] = in[c][pos + p];
+        for (int p = 0; p < chunk; p++)
+        {
+          V spl0 = V::Load(lanes + p * kChannels);
+          V spl1 = spl0;
+          ProcessHalfbandStages<NC>(state.coefs, state.x, state.y, spl0, spl1);
+          spl0.Store(even + p * kChannels);
+          spl1.Store(odd + p * kChannels);
+        }
+        for (int c = 0; c < N; c++)
+        {
+          for (int p = 0; p < chunk; p++)
+          {
+            out[c][2 * (pos + p)] = even[p * kChannels + c];
+            out[c][2 * (pos + p) + 1] = odd[p * kChannels + c];
+          }
+        }
+      }
+      Base::Store(state);
+      return;
+    }
+
+    Scalar lanes[kChannels] = {};
+    Scalar odd[kChannels];
+    for (long p = 0; p < n; p++)
+    {
+      for (int c = 0; c < N; c++)
+        lanes[c] = in[c][p];
+      V spl0 = V::Load(lanes);
+      V spl1 = spl0;
+      ProcessHalfbandStages<NC>(state.coefs, state.x, state.y, spl0, spl1);
+      spl0.Store(lanes);
+      spl1.Store(odd);
+      for (int c = 0; c < N; c++)
+      {
+        out[c][2 * p] = lanes[c];
+        out[c][2 * p + 1] = odd[c];
+      }
+    }
+    Base::Store(state);
+  }
+};
+
+/** Vectorised counterpart of hiir::Downsampler2xFPU */
+template <int NC, typename V>
+class Downsampler2xSIMD : public Halfband2xSIMD<NC, V>
+{
+public:
+  using Base = Halfband2xSIMD<NC, V>;
+  using Scalar = typename Base::Scalar;
+  static constexpr int kChannels = Base::kChannels;
+
+  /** Downsamples 2n samples of nChans <= kChannels channels to n samples */
+  void ProcessBlock(Scalar* const out[], const Scalar* const in[], int nChans, long n) { Dispatch<kChannels>(out, in, nChans, n); }
+
+private:
+  template <int N>
+  void Dispatch(Scalar* const out[], const Scalar* const in[], int nChans, long n)
+  {
+    if constexpr (N > 1)
+    {
+      if (nChans < N)
+        return Dispatch<N - 1>(out, in, nChans, n);
+    }
+    Process<N>(out, in, n);
+  }
+
+  template <int N>
+  void Process(Scalar* const out[], const Scalar* const in[], long n)
+  {
+    typename Base::State state;
+    Base::Load(state);
+    if constexpr (Base::kChunked)
+    {
+      constexpr int size = Base::kChunkSize;
+      Scalar even[size * kChannels] = {};
+      Scalar odd[size * kChannels] = {};
+      for (long pos = 0; pos < n; pos += size)
+      {
+        const int chunk = static_cast<int>(std::min<long>(size, n - pos));
+        for (int c = 0; c < N; c++)
+        {
+          for (int p = 0; p < chunk; p++)
+          {
+            even[p * kChannels + c] = in[c][2 * (pos + p)];
+            odd[p * kChannels + c] = in[c][2 * (pos + p) + 1];
+          }
+        }
+        for (int p = 0; p < chunk; p++)
+        {
+          V spl0 = V::Load(odd + p * kChannels);
+          V spl1 = V::Load(even + p * kChannels);
+          ProcessHalfbandStages<NC>(state.coefs, state.x, state.y, spl0, spl1);
+          (V::Set(.5) * (spl0 + spl1)).Store(even + p * kChannels);
+        }
+        for (int c = 0; c < N; c++)
+          for (int p = 0; p < chunk; p++)
+            out[c][pos + p] = even[p * kChannels + c];
+      }
+      Base::Store(state);
+      return;
+    }
+
+    Scalar even[kChannels] = {};
+    Scalar odd[kChannels] = {};
+    for (long p = 0; p < n; p++)
+    {
+      for (int c = 0; c < N; c++)
+      {
+        even[c] = in[c][2 * p];
+        odd[c] = in[c][2 * p + 1];
+      }
+      V spl0 = V::Load(odd);
+      V spl1 = V::Load(even);
+      ProcessHalfbandStages<NC>(state.coefs, state.x, state.y, spl0, spl1);
+      (V::Set(.5) * (spl0 + spl1)).Store(even);
+      for (int c = 0; c < N; c++)
+        out[c][p] = even[c];
+    }
+    Base::Store(state);
+  }
+};
+} // namespace simd
+END_IPLUG_NAMESPACE
@@ -0,0 +1,187 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <vector>
+
+#include "IPlugConstants.h"
+#include "IPlugPlatform.h"
+
+BEGIN_IPLUG_NAMESPACE
+
+/** Linear-phase half-band FIR for 2x resampling, a Kaiser windowed sinc of 4 * halfLength - 1 taps.
+ * Every second tap apart from the centre is zero, so each polyphase branch is either a symmetric FIR of 2 * halfLength taps or a pure delay. */
+template <typename T = double>
+class HalfbandFIR
+{
+public:
+  void Design(int halfLength, double attenuationdB = 120.)
+  {
+    mHalfLength = halfLength;
+    std::vector<double> coefs(halfLength);
+    const double beta = 0.1102 * (attenuationdB - 8.7);
+    const int centre = 2 * halfLength - 1;
+    double sum = 0.;
+    for (int i = 0; i < halfLength; i++)
+    {
+      // Tap 2i of the full filter, an odd distance away from the centre
+      const double k = centre - 2 * i;
+      const double r = k / centre;
+      const double window = BesselI0(beta * std::sqrt(1. - r * r)) / BesselI0(beta);
+      coefs[i] = std::sin(PI * k * .5) / (PI * k) * window;
+      sum += 2. * coefs[i];
+    }
+    // The non-zero taps form one polyphase branch, which has to sum to 0.5 for unity gain
+    mCoefs.resize(halfLength);
+    for (int i = 0; i < halfLength; i++)
+      mCoefs[i] = static_cast<T>(coefs[i] * (.5 / sum));
+  }
+
+  /** Group delay in samples at the higher rate */
+  int GetLatency() const { return 2 * mHalfLength - 1; }
+
+protected:
+  static double BesselI0(double x)
+  {
+    double sum = 1., term = 1.;
+    for (int k = 1; k < 64 && term > sum * 1e-17; k++)
+    {
+      term *= (x * .5 / k) * (x * .5 / k);
+      sum += term;
+    }
+    return sum;
+  }
+
+  // mBuffer holds mHistory samples of history followed by up to kChunkSize new input samples, so every filter window is contiguous
+  static constexpr int kChunkSize = 64;
+
+  void InitHistory(int history)
+  {
+    mHistory = history;
+    mBuffer.assign(history + kChunkSize, 0.);
+  }
+
+  void ClearHistory() { std::fill(mBuffer.begin(), mBuffer.end(), 0.); }
+
+  /** Appends n <= kChunkSize samples after the history */
+  T* Append(const T* in, int n)
+  {
+    std::copy(in, in + n, mBuffer.data() + mHistory);
+    return mBuffer.data();
+  }
+
+  /** Keeps the newest mHistory samples after n appended samples have been processed */
+  void Consume(int n) { std::copy(mBuffer.data() + n, mBuffer.data() + n + mHistory, mBuffer.data()); }
+
+  /** The non-zero taps applied to x[Stride * i], i < 2 * mHalfLength, x points at the oldest sample of the window. Accumulates in T. */
+  template <int Stride>
+  T Convolve(const T* x) const
+  {
+    const int n = mHalfLength;
+    const int last = 2 * n - 1;
+    const T* coefs = mCoefs.data();
+    // Four partial sums keep the additions from forming one long dependency chain
+    T sum0 = 0., sum1 = 0., sum2 = 0., sum3 = 0.;
+    int i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+      sum0 += coefs[i] * (x[Stride * i] + x[Stride * (last - i)]);
+      sum1 += coefs[i + 1] * (x[Stride * (i + 1)] + x[Stride * (last - i - 1)]);
+      sum2 += coefs[i + 2] * (x[Stride * (i + 2)] + x[Stride * (last - i - 2)]);
+      sum3 += coefs[i + 3] * (x[Stride * (i + 3)] + x[Stride * (last - i - 3)]);
+    }
+    for (; i < n; i++)
+      sum0 += coefs[i] * (x[Stride * i] + x[Stride * (last - i)]);
+    return (sum0 + sum1) + (sum2 + sum3);
+  }
+
+  int mHalfLength = 0;
+  std::vector<T> mCoefs; // one half of the symmetric non-zero taps, outermost first
+  std::vector<T> mBuffer;
+  int mHistory = 0;
+};
+
+template <typename T = double>
+class Upsampler2xFIR : public HalfbandFIR<T>
+{
+public:
+  using Base = HalfbandFIR<T>;
+
+  void Design(int halfLength, double attenuationdB = 120.)
+  {
+    Base::Design(halfLength, attenuationdB);
+    Base::InitHistory(2 * halfLength - 1);
+  }
+
+  void Clear() { Base::ClearHistory(); }
+
+  /** out receives 2n samples */
+  void ProcessBlock(T* out, const T* in, long n)
+  {
+    const int halfLength = Base::mHalfLength;
+    for (long pos = 0; pos < n; pos += Base::kChunkSize)
+    {
+      const int chunk = static_cast<int>(std::min<long>(Base::kChunkSize, n - pos));
+      const T* buffer = Base::Append(in + pos, chunk);
+      for (int p = 0; p < chunk; p++)
+      {
+        const T* x = buffer + p;
+        // The zero-stuffed input needs a gain of 2 to keep the level
+        out[2 * (pos + p)] = static_cast<T>(2.) * Base::template Convolve<1>(x);
+        out[2 * (pos + p) + 1] = x[halfLength];
+      }
+      Base::Consume(chunk);
+    }
+  }
+};
+
+template <typename T = double>
+class Downsampler2xFIR : public HalfbandFIR<T>
+{
+public:
+  using Base = HalfbandFIR<T>;
+
+  static constexpr int kMaxDelay = 16;
+
+  void Design(int halfLength, double attenuationdB = 120.)
+  {
+    Base::Design(halfLength, attenuationdB);
+    Base::InitHistory(4 * halfLength - 2 + kMaxDelay);
+  }
+
+  /** Adds a pure delay in samples at the higher rate, used to round the latency of a cascade to whole samples. Realtime safe. */
+  void SetDelay(int delay)
+  {
+    assert(delay >= 0 && delay < kMaxDelay);
+    mDelay = delay;
+  }
+
+  int GetLatency() const { return Base::GetLatency() + mDelay; }
+
+  void Clear() { Base::ClearHistory(); }
+
+  /** in holds 2n samples */
+  void ProcessBlock(T* out, const T* in, long n)
+  {
+    const int centre = 2 * Base::mHalfLength - 1;
+    const int offset = Base::mHistory - mDelay - 2 * centre;
+    for (long pos = 0; pos < n; pos += Base::kChunkSize / 2)
+    {
+      const int chunk = static_cast<int>(std::min<long>(Base::kChunkSize / 2, n - pos));
+      const T* buffer = Base::Append(in + 2 * pos, 2 * chunk);
+      for (int p = 0; p < chunk; p++)
+      {
+        // The window ends mDelay samples before in[2p], the filter taps sit at the even distances
+        const T* x = buffer + offset + 2 * p;
+        out[pos + p] = static_cast<T>(.5) * x[centre] + Base::template Convolve<2>(x);
+      }
+      Base::Consume(2 * chunk);
+    }
+  }
+
+private:
+  int mDelay = 0;
+};
+
+END_IPLUG_NAMESPACE
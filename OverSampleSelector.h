@@ -97,7 +97,7 @@ void OverSampleButton::DrawButtonText(IGraphics& g, const IRECT& r, WidgetColorS
 class OverSampleSelector : public IContainerBase
 {
 public:
-  OverSampleSelector(const IRECT& bounds, int paramIdxToggle, int paramIdxOnline, int paramIdxOffline, const RCStyle& style = DEFAULT_RCSTYLE, EDirection direction = EDirection::Horizontal);
+  OverSampleSelector(const IRECT& bounds, int paramIdxToggle, int paramIdxOnline, int paramIdxOffline, int paramIdxAntiAlias, int paramIdxFilter, const RCStyle& style = DEFAULT_RCSTYLE, EDirection direction = EDirection::Horizontal);
 
   virtual ~OverSampleSelector() { mChildren.Empty(); }
   virtual const char* GetDisplayText();
@@ -115,6 +115,8 @@ protected:
   const int activateIdx = 0;
   const int onlineIdx = 1;
   const int offlineIdx = 2;
+  const int antiAliasIdx = 3;
+  const int filterIdx = 4;
 
   void populateMenuItems(IPopupMenu& menu, int idx, int startingIdx = 0)
   {
@@ -134,8 +136,8 @@ protected:
   }
 };
 
-OverSampleSelector::OverSampleSelector(const IRECT& bounds, int paramIdxToggle, int paramIdxOnline, int paramIdxOffline, const RCStyle& style, EDirection direction)
-  : IContainerBase(bounds, {paramIdxToggle, paramIdxOnline, paramIdxOffline})
+OverSampleSelector::OverSampleSelector(const IRECT& bounds, int paramIdxToggle, int paramIdxOnline, int paramIdxOffline, int paramIdxAntiAlias, int paramIdxFilter, const RCStyle& style, EDirection direction)
+  : IContainerBase(bounds, {paramIdxToggle, paramIdxOnline, paramIdxOffline, paramIdxAntiAlias, paramIdxFilter})
   , mDirection(direction)
   , mStyle(style)
 {
@@ -196,6 +198,20 @@ void OverSampleSelector::CreateCustomContextMenu(IPopupMenu& contextMenu, const
   auto OfflinePopupMenu = new IPopupMenu("Offline");
   populateMenuItems(*OfflinePopupMenu, offlineIdx);
   auto* pOfflineMenu = contextMenu.AddItem("Offline", OfflinePopupMenu)->GetSubmenu();
+  auto AntiAliasPopupMenu = new IPopupMenu("Anti-Aliasing");
+  populateMenuItems(*AntiAliasPopupMenu, antiAliasIdx);
+  auto* pAntiAliasMenu = contextMenu.AddItem("Anti-Aliasing", AntiAliasPopupMenu)->GetSubmenu();
+  auto FilterPopupMenu = new IPopupMenu("Filter");
+  populateMenuItems(*FilterPopupMenu, filterIdx);
+  auto* pFilterMenu = contextMenu.AddItem("Filter", FilterPopupMenu)->GetSubmenu();
+  auto filterMenuFunc = [this](IPopupMenu* pMenu) {
+    SetValue(GetParam(filterIdx)->ToNormalized(pMenu->GetChosenItemIdx()), filterIdx);
+    SetDirty(true, filterIdx);
+  };
+  auto antiAliasMenuFunc = [this](IPopupMenu* pMenu) {
+    SetValue(GetParam(antiAliasIdx)->ToNormalized(pMenu->GetChosenItemIdx()), antiAliasIdx);
+    SetDirty(true, antiAliasIdx);
+  };
   auto offlineMenuFunc = [this](IPopupMenu* pMenu) {
     SetValue(GetParam(offlineIdx)->ToNormalized(pMenu->GetChosenItemIdx()), offlineIdx);
     SetDirty(true, offlineIdx);
@@ -207,6 +223,8 @@ void OverSampleSelector::CreateCustomContextMenu(IPopupMenu& contextMenu, const
     mButtonControl->SetValueStr(GetDisplayText());
   };
   pOfflineMenu->SetFunction(offlineMenuFunc);
+  pAntiAliasMenu->SetFunction(antiAliasMenuFunc);
+  pFilterMenu->SetFunction(filterMenuFunc);
   GetUI()->CreatePopupMenu(*this, contextMenu, bounds);
   contextMenu.SetFunction(menufunc);
 }
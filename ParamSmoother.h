@@ -0,0 +1,73 @@
+#pragma once
+
+#include <algorithm>
+
+/** Linear ramp towards a target value, for removing zipper noise from parameter changes.
+ * A new target restarts the ramp from the current value, so the ramp always takes the same time. Once the target is reached IsSmoothing()
+ * turns false and callers can use GetValue() as a constant, a parameter that doesn't move costs nothing. */
+class ParamSmoother
+{
+public:
+  explicit ParamSmoother(double value = 0.) { Reset(value); }
+
+  /** Length of a ramp in samples, applies from the next SetTarget() */
+  void SetRampLength(int samples) { mRampLength = std::max(samples, 1); }
+
+  /** Jumps to value, ending any ramp */
+  void Reset(double value)
+  {
+    mValue = mTarget = value;
+    mRemaining = 0;
+  }
+
+  /** Jumps to the current target */
+  void Settle() { Reset(mTarget); }
+
+  void SetTarget(double target)
+  {
+    if (target == mTarget)
+      return;
+    mTarget = target;
+    mRemaining = mRampLength;
+    mStep = (mTarget - mValue) / mRampLength;
+  }
+
+  bool IsSmoothing() const { return mRemaining > 0; }
+  double GetValue() const { return mValue; }
+  double GetTarget() const { return mTarget; }
+
+  /** Writes the next n values to out */
+  template <typename T>
+  void Process(T* out, int n)
+  {
+    const int nRamp = std::min(n, mRemaining);
+    for (int s = 0; s < nRamp; s++)
+      out[s] = static_cast<T>(mValue += mStep);
+    Advance(nRamp);
+    std::fill(out + nRamp, out + n, static_cast<T>(mValue));
+  }
+
+  /** Moves n samples along the ramp without writing the values, returns the value reached */
+  double Skip(int n)
+  {
+    const int nRamp = std::min(n, mRemaining);
+    mValue += mStep * nRamp;
+    Advance(nRamp);
+    return mValue;
+  }
+
+private:
+  void Advance(int n)
+  {
+    mRemaining -= n;
+    // Lands exactly on the target, whatever the rounding along the way
+    if (!mRemaining)
+      mValue = mTarget;
+  }
+
+  double mValue = 0.;
+  double mTarget = 0.;
+  double mStep = 0.;
+  int mRampLength = 1;
+  int mRemaining = 0;
+};
@@ -2,6 +2,7 @@
 #include "IControls.h"
 #include "IPlug_include_in_plug_src.h"
 #include "OverSampleSelector.h"
+#include "AnalyzerDisplay.h"
 #include "SineWaveshaperDisplay.h"
 #include "widgets/Color.h"
 #include "widgets/RCButton.h"
@@ -15,7 +16,9 @@
 RCSiner::RCSiner(const InstanceInfo& info)
   : iplug::Plugin(info, MakeConfig(kNumParams, kNumPresets))
 {
-  GetParam(kAlgorithm)->InitEnum("Algorithm", 0, mSineWaveshaper.Algorithms);
+  GetParam(kAlgorithm)->InitEnum("Algorithm", 0, SineWaveshaper::kNumAlgorithms);
+  for (int i = 0; i < SineWaveshaper::kNumAlgorithms; i++)
+    GetParam(kAlgorithm)->SetDisplayText(i, SineWaveshaper::GetAlgorithmName(i));
   GetParam(kSync)->InitDouble("Sync", 1., .5, 16., .001, "", 0, "", IParam::ShapeExp());
   GetParam(kPull)->InitDouble("Pull", 1., .25, 4., .001, "", 0, "", IParam::ShapeExp());
   GetParam(kDeform)->InitDouble("Deform", 1., .25, 4., .001, "", 0, "", IParam::ShapeExp());
@@ -26,8 +29,15 @@ RCSiner::RCSiner(const InstanceInfo& info)
   GetParam(kOutputGain)->InitDouble("Output Gain", -6., -96., 12., .1, "dB", 0, "", IParam::ShapePowCurve(0.5));
   GetParam(kWetness)->InitDouble("Wetness", 100., 0., 100., .1, "%");
   GetParam(kOverSample)->InitBool("OverSample Switch", 0);
-  GetParam(kOverSampleOnline)->InitEnum("OverSample", 0, {"1x", "2x", "4x", "8x", "16x"});
-  GetParam(kOverSampleOffline)->InitEnum("OverSample (Render)", 0, {"Same as real-time", "1x", "2x", "4x", "8x", "16x"});
+  GetParam(kOverSampleOnline)->InitEnum("OverSample", 0, {"1x", "2x", "4x", "8x", "16x", "Auto"});
+  GetParam(kOverSampleOffline)->InitEnum("OverSample (Render)", 0, {"Same as real-time", "1x", "2x", "4x", "8x", "16x", "Auto"});
+  GetParam(kCurveTable)->InitEnum("Curve Table", 0, {"Off", "Linear", "Cubic"});
+  GetParam(kAntiAlias)->InitEnum("Anti-Aliasing", 0, {"Off", "ADAA", "ADAA 2nd order"});
+  GetParam(kOverSampleFilter)->InitEnum("OverSample Filter", 0, {"Low Latency", "Linear Phase"});
+  GetParam(kSilenceThreshold)->InitDouble("Silence Threshold", RCSinerDSP::kDefaultSilenceThreshold, -150., -60., 1., "dB");
+  GetParam(kPrecision)->InitEnum("Precision", 0, {"64-bit", "32-bit"});
+  GetParam(kQuality)->InitEnum("Quality", SineWaveshaper::kHigh, {"Exact", "High", "Eco"});
+  GetParam(kQualityOffline)->InitEnum("Quality (Render)", 0, {"Same as real-time", "Exact", "High", "Eco"});
 
 #if IPLUG_EDITOR // http://bit.ly/2S64BDd
   mMakeGraphicsFunc = [&]() { return MakeGraphics(*this, PLUG_WIDTH, PLUG_HEIGHT, PLUG_FPS, GetScaleForScreen(PLUG_WIDTH, PLUG_HEIGHT)); };
@@ -146,7 +156,7 @@ RCSiner::RCSiner(const InstanceInfo& info)
 
     pGraphics->AttachControl(new RCDragBox(rectHeaderDryWetSlider, kWetness, "", RCDragBox::Horizontal, styleDryWet));
     pGraphics->AttachControl(new RCLabel(rectHeaderDryWetLabel, "Mix", EDirection::Horizontal, styleDryWetHeader, 0.0f, RCLabel::End));
-    pGraphics->AttachControl(new OverSampleSelector(rectHeaderOverSampleSlider, kOverSample, kOverSampleOnline, kOverSampleOffline, styleOverSample));
+    pGraphics->AttachControl(new OverSampleSelector(rectHeaderOverSampleSlider, kOverSample, kOverSampleOnline, kOverSampleOffline, kAntiAlias, kOverSampleFilter, styleOverSample));
     pGraphics->AttachControl(new RCLabel(rectHeaderOverSampleLabel, "OS", EDirection::Horizontal, styleDryWetHeader, 0.0f, RCLabel::End));
     pGraphics->AttachControl(new RCPeakAvgMeterControl<2>(rectHeaderVolumeMeter, ivstyleVolumeMeter, EDirection::Vertical, {}, 0, -90.f, 0.f, {}), kCtrlTagOutputMeter);
 
@@ -211,7 +221,29 @@ RCSiner::RCSiner(const InstanceInfo& info)
     pGraphics->AttachControl(new RCSlider(rectWaveformOutSlider, kOutputGain, "", RCSlider::Vertical, styleOutput));
     pGraphics->AttachControl(new RCDragBox(rectWaveformSelector, kAlgorithm, "", RCDragBox::Horizontal, styleSelector));
     // pGraphics->AttachControl(new RCButton(rectWaveformSelector, kAlgorithm, "", styleSelector));
-    pGraphics->AttachControl(new SineWaveshaperDisplay(rectWaveformDisplay, mSineWaveshaper, styleDisplay), kCtrlSineWaveshaperDisplay);
+    pGraphics->AttachControl(new SineWaveshaperDisplay(rectWaveformDisplay, mDisplayShaper, styleDisplay), kCtrlSineWaveshaperDisplay);
+    pGraphics->AttachControl(new AnalyzerDisplay(rectWaveformDisplay, mAnalyzerFeed, styleDisplay), kCtrlAnalyzerDisplay);
+    pGraphics->GetControlWithTag(kCtrlAnalyzerDisplay)->Hide(true);
+    // Right click on the display switches from the transfer curve to the scope, the spectrum and back
+    auto switchDisplay = [pGraphics](IControl* pCaller) {
+      IControl* curve = pGraphics->GetControlWithTag(kCtrlSineWaveshaperDisplay);
+      auto* analyzer = static_cast<AnalyzerDisplay*>(pGraphics->GetControlWithTag(kCtrlAnalyzerDisplay));
+      if (!curve->IsHidden())
+      {
+        curve->Hide(true);
+        analyzer->SetMode(AnalyzerDisplay::kScope);
+        analyzer->Hide(false);
+      }
+      else if (analyzer->GetMode() == AnalyzerDisplay::kScope)
+        analyzer->SetMode(AnalyzerDisplay::kSpectrum);
+      else
+      {
+        analyzer->Hide(true);
+        curve->Hide(false);
+      }
+    };
+    pGraphics->GetControlWithTag(kCtrlSineWaveshaperDisplay)->SetActionFunction(switchDisplay);
+    pGraphics->GetControlWithTag(kCtrlAnalyzerDisplay)->SetActionFunction(switchDisplay);
 
     // Control Section
     IRECT rectControlInPadding = rectControls.GetOffset(sizePaddingModule, 0.f, -sizePaddingModule, -sizePaddingModule);
@@ -256,115 +288,251 @@ RCSiner::RCSiner(const InstanceInfo& info)
 }
 
 #if IPLUG_DSP
-void RCSiner::OnIdle() { mOutputPeakSender.TransmitData(*this); }
+void RCSiner::OnIdle()
+{
+  mOutputPeakSender.TransmitData(*this);
+
+  // The display gets its shaper from here, the audio thread publishes its own at the start of a block
+  if (mDisplayShaperChanged.exchange(false))
+  {
+    SineWaveshaper shaper;
+    ConfigureWaveshaper(shaper);
+    mDisplayShaper.Publish(shaper);
+  }
+
+  if (mLatencyChanged.exchange(false))
+  {
+    UpdateLatency();
+    UpdateTailSize();
+  }
+
+  // Realtime processing gets its curve tables and the buffers of new settings from here, off the audio thread
+  UpdateCurveTable();
+  mDSP.Prepare(GetParam(kPrecision)->Bool(), CanCrossfade());
+}
+
+void RCSiner::ConfigureWaveshaper(SineWaveshaper& shaper)
+{
+  shaper.SetAlgorithm(GetParam(kAlgorithm)->Int());
+  shaper.SetSync(GetParam(kSync)->Value());
+  shaper.SetPull(GetParam(kPull)->Value());
+  shaper.SetDeform(GetParam(kDeform)->Value());
+  shaper.SetStages(GetParam(kStages)->Value());
+  shaper.SetPreClip(GetParam(kPreClip)->Bool());
+  shaper.SetPostClip(GetParam(kPostClip)->Bool());
+}
+
 void RCSiner::OnParamChange(int idx)
 {
-  auto value = GetParam(idx)->Value();
   switch (idx)
   {
   case kAlgorithm:
-    mSineWaveshaper.SetAlgorithm(value);
-    if (const auto ui = GetUI())
-      if (const auto ctrl = ui->GetControlWithTag(kCtrlSineWaveshaperDisplay))
-        ctrl->SetDirty(false);
+  case kSync:
+  case kPull:
+  case kDeform:
+  case kStages:
+  case kPreClip:
+  case kPostClip:
+    // Called on the UI thread and, for host automation, on the audio thread, so the shapers are built by their single producers
+    mDSPShaperChanged = true;
+    mDisplayShaperChanged = true;
+    break;
+  case kOverSample:
+  case kOverSampleOnline:
+  case kOverSampleOffline:
+  case kOverSampleFilter:
+  case kAntiAlias:
+  case kSilenceThreshold:
+    // SetLatency() may make the host restart processing, which it doesn't allow from the audio thread, so OnIdle() reports the change
+    mLatencyChanged = true;
     break;
+  }
+}
+
+// The parameters mDSP smooths, which are also the ones automated with sample accuracy
+static bool IsSampleAccurate(int idx)
+{
+  switch (idx)
+  {
+  case kSync:
+  case kPull:
+  case kDeform:
+  case kStages:
+  case kInputGain:
+  case kOutputGain:
+  case kWetness:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void RCSiner::OnParamChange(int idx, EParamSource source, int sampleOffset)
+{
+  // Host automation inside the block about to be processed is queued, ProcessBlock() applies it at its offset
+  if (source == kHost && sampleOffset > 0 && IsSampleAccurate(idx) && mNumParamEvents < kMaxParamEvents)
+  {
+    int pos = mNumParamEvents++;
+    for (; pos > 0 && mParamEvents[pos - 1].offset > sampleOffset; pos--)
+      mParamEvents[pos] = mParamEvents[pos - 1];
+    mParamEvents[pos] = {sampleOffset, idx, GetParam(idx)->Value()};
+    mParamHasEvent[idx] = true;
+  }
+  OnParamChange(idx);
+}
+
+void RCSiner::SetDSPParam(int idx, double value)
+{
+  switch (idx)
+  {
   case kSync:
-    mSineWaveshaper.SetSync(value);
-    if (const auto ui = GetUI())
-      if (const auto ctrl = ui->GetControlWithTag(kCtrlSineWaveshaperDisplay))
-        ctrl->SetDirty(false);
+    mDSP.SetSync(value);
     break;
   case kPull:
-    mSineWaveshaper.SetPull(value);
-    if (const auto ui = GetUI())
-      if (const auto ctrl = ui->GetControlWithTag(kCtrlSineWaveshaperDisplay))
-        ctrl->SetDirty(false);
+    mDSP.SetPull(value);
     break;
   case kDeform:
-    mSineWaveshaper.SetDeform(value);
-    if (const auto ui = GetUI())
-      if (const auto ctrl = ui->GetControlWithTag(kCtrlSineWaveshaperDisplay))
-        ctrl->SetDirty(false);
+    mDSP.SetDeform(value);
     break;
   case kStages:
-    mSineWaveshaper.SetStages(value);
-    if (const auto ui = GetUI())
-      if (const auto ctrl = ui->GetControlWithTag(kCtrlSineWaveshaperDisplay))
-        ctrl->SetDirty(false);
-    break;
-  case kPreClip:
-    mSineWaveshaper.SetPreClip(value);
+    mDSP.SetStages(value);
     break;
-  case kPostClip:
-    mSineWaveshaper.SetPostClip(value);
+  case kInputGain:
+    mDSP.SetInputGain(value);
     break;
-  case kOverSampleOnline:
-    mPendingUpdateOversampler = true;
-    if (!GetParam(kOverSampleOffline)->Value())
-      mPendingUpdateOfflineOversampler = true;
+  case kOutputGain:
+    mDSP.SetOutputGain(value);
     break;
-  case kOverSampleOffline:
-    mPendingUpdateOfflineOversampler = true;
+  case kWetness:
+    mDSP.SetWetness(value);
     break;
   }
 }
 
 void RCSiner::OnReset()
 {
-  auto blocksize = GetBlockSize();
-  mOversampler.SetBlockSize(blocksize);
-  mOversamplerOffline.SetBlockSize(blocksize);
+  mDSP.SetChannels(NOutChansConnected());
+  mDSP.Reset(GetSampleRate(), GetBlockSize());
+  // Surround buses get a thread per channel group for offline renders, started by the first one, stereo stays on the audio thread
+  mDSP.SetThreads(NOutChansConnected() > 2 ? 0 : 1);
+  // Only what the current settings need, 32-bit processing and crossfades are added by OnIdle() once they are switched on
+  mDSP.Allocate(GetParam(kPrecision)->Bool(), CanCrossfade());
+  mNumParamEvents = 0;
+  std::fill(std::begin(mParamHasEvent), std::end(mParamHasEvent), false);
   mOutputPeakSender.Reset(GetSampleRate());
+  mAnalyzerFeed.Reset(GetSampleRate(), GetBlockSize());
+  // Nothing is processing, so the first block already finds its shaper and curve table instead of waiting for OnIdle()
+  mDSPShaperChanged = false;
+  ConfigureWaveshaper(mShaper);
+  mDSP.SetShaper(mShaper);
+  UpdateCurveTable();
+  mLatencyChanged = false;
+  UpdateLatency();
+  UpdateTailSize();
 }
 
-void RCSiner::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
+EFactor RCSiner::GetCurrentFactor() const
+{
+  return GetOverSamplingFactor(GetParam(kOverSample)->Bool(), GetParam(kOverSampleOnline)->Int(), GetParam(kOverSampleOffline)->Int(), GetRenderingOffline());
+}
+
+bool RCSiner::IsCurrentFactorAuto() const
+{
+  return IsOverSamplingAuto(GetParam(kOverSample)->Bool(), GetParam(kOverSampleOnline)->Int(), GetParam(kOverSampleOffline)->Int(), GetRenderingOffline());
+}
+
+void RCSiner::UpdateLatency()
 {
-  const double wetAmp = GetParam(kWetness)->Value() * .01;
-  const double dryAmp = 1. - wetAmp;
-  const double inGain = iplug::DBToAmp(GetParam(kInputGain)->Value());
-  const double outGain = iplug::DBToAmp(GetParam(kOutputGain)->Value());
-  const int nChans = NOutChansConnected();
-  const auto oversample = GetParam(kOverSample)->Value();
-
-  const auto oversampleOnline = static_cast<EFactor>(GetParam(kOverSampleOnline)->Value());
-  const auto oversampleOfflineValue = GetParam(kOverSampleOffline)->Value();
-  const auto oversampleOffline = !oversampleOfflineValue ? oversampleOnline : static_cast<EFactor>(oversampleOfflineValue - 1.);
-
-  if (mPendingUpdateOversampler)
+  const int latency = RCSinerDSP::GetLatency(GetCurrentFactor(), static_cast<EFilterType>(GetParam(kOverSampleFilter)->Int()), IsCurrentFactorAuto(),
+                                             GetParam(kAntiAlias)->Int());
+  if (latency != GetLatency())
+    SetLatency(latency);
+}
+
+void RCSiner::UpdateTailSize()
+{
+  const auto filterType = static_cast<EFilterType>(GetParam(kOverSampleFilter)->Int());
+  SetTailSize(RCSinerDSP::GetTailSize(GetCurrentFactor(), filterType, IsCurrentFactorAuto(), GetParam(kAntiAlias)->Int(), GetParam(kSilenceThreshold)->Value()));
+}
+
+bool RCSiner::CanCrossfade() const
+{
+  return RCSinerDSP::CanCrossfade(GetCurrentFactor(), static_cast<EFilterType>(GetParam(kOverSampleFilter)->Int()), IsCurrentFactorAuto(), GetParam(kAntiAlias)->Int());
+}
+
+void RCSiner::UpdateCurveTable()
+{
+  if ((GetParam(kCurveTable)->Int() || GetParam(kAntiAlias)->Int()) && mDSP.IsCurveTableOutdated())
   {
-    mOversampler.SetOverSampling(oversampleOnline);
-    mPendingUpdateOversampler = false;
+    // Reading the version first tags the table with an older version if a parameter changes meanwhile, so it is rebuilt next time
+    const int version = mDSP.GetShaperVersion();
+    SineWaveshaper shaper;
+    ConfigureWaveshaper(shaper);
+    mDSP.UpdateCurveTable(shaper, version);
   }
-  if (mPendingUpdateOfflineOversampler)
+}
+
+void RCSiner::ProcessBlock(sample** inputs, sample** outputs, int nFrames)
+{
+  // The host's floating point mode is restored on return
+  const simd::ScopedFlushDenormals flushDenormals;
+  // mDSP is sized by OnReset(), which hosts call after changing the buses
+  const int nChans = std::min(NOutChansConnected(), mDSP.NChannels());
+  for (int c = nChans; c < NOutChansConnected(); c++)
+    std::fill(outputs[c], outputs[c] + nFrames, 0.);
+
+  // The audio thread only ever sees complete configurations
+  if (mDSPShaperChanged.exchange(false))
   {
-    mOversamplerOffline.SetOverSampling(oversampleOffline);
-    mPendingUpdateOfflineOversampler = false;
+    ConfigureWaveshaper(mShaper);
+    mDSP.SetShaper(mShaper);
   }
-
-  auto processFunc = [&](sample** osinputs, sample** osoutputs, int osnFrames) {
-    for (int s = 0; s < osnFrames; s++)
-    {
-      for (int c = 0; c < nChans; c++)
-      {
-        const auto spl = osinputs[c][s];
-        if (!spl)
-          continue; // This skips calculation because SineWaveshaper always return 0 when x is 0
-        osoutputs[c][s] = spl * dryAmp + mSineWaveshaper.ProcessSample(spl * inGain) * outGain * wetAmp;
-      }
-    }
-  };
-
-  if (oversample)
+  // An offline render may wait for the table and the buffers, so its result doesn't depend on when OnIdle() runs
+  if (GetRenderingOffline())
   {
-    if (GetRenderingOffline())
-      mOversamplerOffline.ProcessBlock(inputs, outputs, nFrames, 2, nChans, processFunc);
-    else
-      mOversampler.ProcessBlock(inputs, outputs, nFrames, 2, nChans, processFunc);
+    UpdateCurveTable();
+    mDSP.Prepare(GetParam(kPrecision)->Bool(), CanCrossfade());
   }
-  else
-    processFunc(inputs, outputs, nFrames);
 
-  if (GetUI())
+  // A parameter with a queued event keeps its previous value until the event, its current value is already the one of the event
+  for (int idx = 0; idx < kNumParams; idx++)
+    if (IsSampleAccurate(idx) && !mParamHasEvent[idx])
+      SetDSPParam(idx, GetParam(idx)->Value());
+  mDSP.SetCurveTable(GetParam(kCurveTable)->Int());
+  mDSP.SetAntiAlias(GetParam(kAntiAlias)->Int());
+  mDSP.SetOverSampling(GetCurrentFactor());
+  mDSP.SetAutoOverSampling(IsCurrentFactorAuto());
+  mDSP.SetOverSamplingFilter(static_cast<EFilterType>(GetParam(kOverSampleFilter)->Int()));
+  mDSP.SetSilenceThreshold(GetParam(kSilenceThreshold)->Value());
+  mDSP.SetSinglePrecision(GetParam(kPrecision)->Bool());
+  mDSP.SetQuality(GetShaperQuality(GetParam(kQuality)->Int(), GetParam(kQualityOffline)->Int(), GetRenderingOffline()));
+  mDSP.SetThreadsEnabled(GetRenderingOffline());
+
+  // The block is split once per distinct offset, events beyond the block are left to the next one, which reads the final values
+  int splits[kMaxParamEvents];
+  int nSplits = 0;
+  for (int i = 0; i < mNumParamEvents && mParamEvents[i].offset < nFrames; i++)
+    if (!nSplits || splits[nSplits - 1] != mParamEvents[i].offset)
+      splits[nSplits++] = mParamEvents[i].offset;
+  // The analyzer only gets audio while the editor is open, the input is taken before the processing overwrites it
+  const bool editorOpen = GetUI() != nullptr;
+  if (editorOpen)
+    mAnalyzerFeed.CaptureInput(inputs, nFrames, nChans);
+
+  int nextEvent = 0;
+  mDSP.ProcessBlock(inputs, outputs, nFrames, nChans, splits, nSplits, [&](int split) {
+    for (; nextEvent < mNumParamEvents && mParamEvents[nextEvent].offset == splits[split]; nextEvent++)
+      SetDSPParam(mParamEvents[nextEvent].idx, mParamEvents[nextEvent].value);
+  });
+
+  for (int i = 0; i < mNumParamEvents; i++)
+    mParamHasEvent[mParamEvents[i].idx] = false;
+  mNumParamEvents = 0;
+
+  if (editorOpen)
+  {
     mOutputPeakSender.ProcessBlock(outputs, nFrames, kCtrlTagOutputMeter, 2);
+    mAnalyzerFeed.PushOutput(outputs, nFrames, nChans);
+  }
 }
 #endif
@@ -1,34 +1,19 @@
 #pragma once
 
-#include "BlockOversampler.h"
+#include "AnalyzerFeed.h"
 #include "IPlug_include_in_plug_hdr.h"
 #include "ISender.h"
-#include "SineWaveshaper.h"
+#include "RCSinerDSP.h"
+#include "RCSinerParams.h"
+#include <atomic>
 
 const int kNumPresets = 1;
 
-enum EParams
-{
-  kAlgorithm = 0,
-  kSync,
-  kPull,
-  kDeform,
-  kStages,
-  kPreClip,
-  kPostClip,
-  kInputGain,
-  kOutputGain,
-  kWetness,
-  kOverSample,
-  kOverSampleOnline,
-  kOverSampleOffline,
-  kNumParams
-};
-
 enum ECtrlTags
 {
   kCtrlTagOutputMeter = 1000, // To avoid debugging other controls being affected
   kCtrlSineWaveshaperDisplay,
+  kCtrlAnalyzerDisplay,
   kNumCtrlTags
 };
 
@@ -43,6 +28,7 @@ public:
 #if IPLUG_DSP // http://bit.ly/2S64BDd
   void OnIdle() override;
   void OnParamChange(int idx) override;
+  void OnParamChange(int idx, EParamSource source, int sampleOffset) override;
   void OnReset() override;
   void ProcessBlock(sample** inputs, sample** outputs, int nFrames) override;
 
@@ -50,9 +36,43 @@ public:
 #endif
 
 private:
-  SineWaveshaper mSineWaveshaper = SineWaveshaper();
-  BlockOverSampler<sample> mOversampler = BlockOverSampler(EFactor::kNone, 2, 2, GetBlockSize());
-  BlockOverSampler<sample> mOversamplerOffline = BlockOverSampler(EFactor::kNone, 2, 2, GetBlockSize());
-  bool mPendingUpdateOversampler = false;
-  bool mPendingUpdateOfflineOversampler = false;
+  void ConfigureWaveshaper(SineWaveshaper& shaper);
+#if IPLUG_DSP
+  EFactor GetCurrentFactor() const;
+  /** Whether the "Auto" entry of the oversampling factors is in use */
+  bool IsCurrentFactorAuto() const;
+  /** Reports the latency of the current oversampling and ADAA settings to the host, never from the audio thread, see mLatencyChanged */
+  void UpdateLatency();
+  /** Reports how long the output rings on after the input fell silent to the host */
+  void UpdateTailSize();
+  /** Passes the value of one of the parameters that can change inside a block to mDSP */
+  void SetDSPParam(int idx, double value);
+  /** Builds the curve table (also used for ADAA) for the newest shaper of mDSP if it is in use and outdated. Not realtime safe. */
+  void UpdateCurveTable();
+  /** Whether the current oversampling settings can crossfade a change of the factor, see RCSinerDSP::Prepare() */
+  bool CanCrossfade() const;
+#endif
+
+  SineWaveshaper mShaper; // configured from the parameters and published to mDSP by the audio thread
+  SnapshotBuffer<SineWaveshaper> mDisplayShaper; // published by OnIdle(), consumed by the SineWaveshaperDisplay on the UI thread
+  // Set by OnParamChange() on whichever thread changed a shaper parameter, taken by the single producer of each shaper
+  std::atomic<bool> mDSPShaperChanged{true};
+  std::atomic<bool> mDisplayShaperChanged{true};
+  std::atomic<bool> mLatencyChanged{false}; // set by OnParamChange() for the latency and tail size, reported by OnIdle()
+  AnalyzerFeed mAnalyzerFeed; // fed by the audio thread while the editor is open, drained by the AnalyzerDisplay
+  RCSinerDSP mDSP; // sized for the connected channels by OnReset()
+
+#if IPLUG_DSP
+  // Host automation with a sample offset inside the next block, ordered by offset, only touched by the audio thread
+  struct ParamEvent
+  {
+    int offset;
+    int idx;
+    double value;
+  };
+  static constexpr int kMaxParamEvents = 128;
+  ParamEvent mParamEvents[kMaxParamEvents];
+  int mNumParamEvents = 0;
+  bool mParamHasEvent[kNumParams] = {};
+#endif
 };
@@ -0,0 +1,998 @@
+#pragma once
+
+#include "AliasMap.h"
+#include "BlockOversampler.h"
+#include "ParamSmoother.h"
+#include "SineWaveshaper.h"
+#include "SnapshotBuffer.h"
+#include "ThreadPool.h"
+#include "TransferCurveTable.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+/** The complete RCSiner signal chain (gain, waveshaper or curve table, ADAA, oversampling and dry/wet mix) without any plugin or graphics dependency.
+ * Shared by the plugin and the headless tools. SetShaper() and UpdateCurveTable() are for other threads, all other setters belong to the audio thread.
+ * The gains ramp per sample and Sync, Pull, Deform and Stages per sub-block of kShaperSubBlockSize samples over kSmoothingTime, a parameter that
+ * doesn't move skips the smoothing altogether. Those continuous parameters are set on the audio thread like the gains, so they can change inside a
+ * block, the shaper passed to SetShaper() provides the rest of the configuration.
+ * Input below the silence threshold is not processed at all once the output has rung out, see GetTailSize().
+ * The oversampling and the shaper run in double precision, or in float with SetSinglePrecision(), converting once per block.
+ * Every channel is processed the same way, SetThreads() splits them into groups that can run in parallel on large blocks.
+ * Only the double precision chain with a single oversampler per group is always there, Prepare() adds the float chain and the second oversampler
+ * of every chain, which lets a change of the factor that keeps the latency fade from one to the other over kCrossfadeTime. */
+class RCSinerDSP
+{
+public:
+  static constexpr double kSmoothingTime = 20.; // ms
+  static constexpr int kShaperSubBlockSize = 32; // at the oversampled rate
+  static constexpr double kDefaultSilenceThreshold = -120.; // dB
+  static constexpr int kMinThreadedFrames = 8192; // per block at the oversampled rate, below it the groups run one after the other
+  static constexpr double kCrossfadeTime = 20.; // ms, from one oversampling factor to the next
+  static constexpr double kAutoHoldTime = 500.; // ms a lower factor has to suffice before Auto switches down to it
+  static constexpr int kMaxPadding = 128; // more than the largest latency of the oversamplers, see GetAutoLatency()
+
+  RCSinerDSP(int nChannels = 2, int blockSize = DEFAULT_BLOCK_SIZE, double sampleRate = DEFAULT_SAMPLE_RATE)
+    : mNChannels(nChannels)
+    , mBlockSize(blockSize)
+    , mSingleInputs(nChannels)
+    , mSingleOutputs(nChannels)
+    , mADAAStates(nChannels)
+    , mDryADAAStates(nChannels)
+  {
+    mGroups.emplace_back(new Group(0, nChannels, blockSize, false, false));
+    Reset(sampleRate, blockSize);
+  }
+
+  RCSinerDSP(const RCSinerDSP&) = delete;
+  RCSinerDSP& operator=(const RCSinerDSP&) = delete;
+
+  /** Hands a complete shaper configuration to the audio thread, which switches to it at the start of its next block. Its Sync, Pull, Deform and
+   * Stages are only used for the curve table, the audio thread takes them from SetSync() etc. Lock-free, but must not be called from two threads at the same time. */
+  void SetShaper(const SineWaveshaper& shaper) { mShaper.Publish(shaper); }
+  /** Version of the newest shaper passed to SetShaper() */
+  int GetShaperVersion() const { return mShaper.GetVersion(); }
+
+  bool IsCurveTableOutdated() const { return mCurveTable.GetVersion() != GetShaperVersion(); }
+
+  /** Rebuild the curve table from shaper, configured like the shaper of version, which should be read before configuring shaper.
+   * The audio thread keeps using the exact path until a table matching its shaper is published. Not realtime safe, but any thread may call it,
+   * including the audio thread of an offline render to have the table in time for its block. A version older than the current table is dropped. */
+  void UpdateCurveTable(const SineWaveshaper& shaper, int version)
+  {
+    std::lock_guard<std::mutex> lock(mCurveTableMutex);
+    if (version > mCurveTable.GetVersion())
+      mCurveTable.Build(shaper, version);
+  }
+
+  void SetInputGain(double dB) { mInGain.SetTarget(iplug::DBToAmp(dB)); }
+  void SetOutputGain(double dB) { mOutGain.SetTarget(iplug::DBToAmp(dB)); }
+  void SetWetness(double percent) { mWetAmp.SetTarget(percent * .01); }
+  void SetSync(double sync) { mSync.SetTarget(sync); }
+  void SetPull(double pull) { mPull.SetTarget(pull); }
+  void SetDeform(double deform) { mDeform.SetTarget(deform); }
+  void SetStages(double stages) { mStages.SetTarget(stages); }
+  /** 0 off, 1 linear, 2 cubic */
+  void SetCurveTable(int mode) { mCurveTableMode = mode; }
+  /** 0 off, otherwise the ADAA order, which adds the whole samples of its delay to the latency, see GetADAALatency() */
+  void SetAntiAlias(int order)
+  {
+    if (order != mADAAOrder)
+    {
+      mADAAOrder = order;
+      UpdatePaddings();
+    }
+  }
+  /** Takes effect at the next ProcessBlock(), which fades over from the previous factor unless it starts from silence or the latency changes */
+  void SetOverSampling(iplug::EFactor factor) { mRequestedFactor = factor; }
+  /** Picks the factor for every block instead, the lowest one AliasMap.h recommends for the shaper, the input gain and the peak of the input.
+   * A higher factor takes over at once, a lower one once it sufficed for kAutoHoldTime. Every factor is padded to the latency of the slowest,
+   * see GetAutoLatency(). */
+  void SetAutoOverSampling(bool autoOverSampling)
+  {
+    if (autoOverSampling != mAutoOverSampling)
+    {
+      mAutoOverSampling = autoOverSampling;
+      mAutoFactor = iplug::EFactor::kNone;
+      mAutoHoldFrames = 0;
+      UpdatePaddings();
+    }
+  }
+  bool IsAutoOverSampling() const { return mAutoOverSampling; }
+  /** The factor in use, in Auto mode the one last picked */
+  iplug::EFactor GetOverSampling() const { return mFactor; }
+  void SetOverSamplingFilter(iplug::EFilterType filterType)
+  {
+    if (filterType == mFilterType)
+      return;
+    mFilterType = filterType;
+    for (auto& group : mGroups)
+      ForEachPath(*group, [filterType](auto& path) { path.oversampler.SetFilterType(filterType); });
+    UpdatePaddings();
+  }
+  void SetSilenceThreshold(double dB) { mSilenceThreshold = iplug::DBToAmp(dB); }
+  /** The math of the shaper, see SineWaveshaper::EQuality. The curve table is always built exactly. */
+  void SetQuality(SineWaveshaper::EQuality quality)
+  {
+    mQuality = quality;
+    if (quality != mWorkShaper.GetQuality())
+      mWorkShaper.SetQuality(quality);
+  }
+  /** Runs the oversampling filters and the shaper in float instead of double: twice the lanes per vector for the shaper and half the memory of the
+   * oversampled buffers. The IIR filters run one channel per lane and only gain from it with more than two channels. Blocks stay in double until
+   * Prepare() has allocated the float chain. The filters taking over start from silence, the same click as a change of the oversampling filter type. */
+  void SetSinglePrecision(bool singlePrecision) { mSinglePrecision = singlePrecision; }
+  bool IsSinglePrecision() const { return mSinglePrecision; }
+  int GetRate() const { return 1 << static_cast<int>(mFactor); }
+  /** The delay of the output in samples, to be reported to the host, for the factor or the Auto mode and the ADAA order set last */
+  int GetLatency() const { return GetLatency(mRequestedFactor, mFilterType, mAutoOverSampling, mADAAOrder); }
+
+  static int GetLatency(iplug::EFactor factor, iplug::EFilterType filterType, bool autoOverSampling, int adaaOrder)
+  {
+    return autoOverSampling ? GetAutoLatency(filterType, adaaOrder) : GetPathLatency(factor, filterType, adaaOrder);
+  }
+
+  /** The latency of the slowest factor, which the Auto mode pads every factor to, so the host sees the same delay whichever one it picks */
+  static int GetAutoLatency(iplug::EFilterType filterType, int adaaOrder)
+  {
+    int latency = 0;
+    for (int factor = 0; factor < iplug::kNumFactors; factor++)
+      latency = std::max(latency, GetPathLatency(static_cast<iplug::EFactor>(factor), filterType, adaaOrder));
+    return latency;
+  }
+
+  /** The whole samples ADAA delays by at the original rate, half a sample per order at the rate it runs at: one for 2nd order at 1x.
+   * The rest, half a sample for 1st order at 1x and the fractions at higher factors, is not compensated. */
+  static int GetADAALatency(iplug::EFactor factor, int adaaOrder) { return adaaOrder / (2 << static_cast<int>(factor)); }
+
+  /** Whether a change of the factor away from factor can crossfade, which needs the second oversampler of Prepare(): always in Auto mode,
+   * otherwise only towards a factor of the same latency */
+  static bool CanCrossfade(iplug::EFactor factor, iplug::EFilterType filterType, bool autoOverSampling, int adaaOrder)
+  {
+    if (autoOverSampling)
+      return true;
+    for (int other = 0; other < iplug::kNumFactors; other++)
+      if (other != factor && GetPathLatency(static_cast<iplug::EFactor>(other), filterType, adaaOrder) == GetPathLatency(factor, filterType, adaaOrder))
+        return true;
+    return false;
+  }
+
+  /** Allocates the float chain of SetSinglePrecision() and the second oversampler of every chain for crossfades, see CanCrossfade(), unless they
+   * are there already. The audio thread takes them over at the start of its next block, until then it runs in double and switches the factor at
+   * once. Not realtime safe, but any thread may call it while processing, including the audio thread of an offline render. Only ever adds,
+   * Allocate() also frees. */
+  void Prepare(bool singlePrecision, bool crossfades)
+  {
+    std::lock_guard<std::mutex> lock(mAllocationMutex);
+    AddAllocations(singlePrecision, crossfades);
+  }
+
+  /** Like Prepare(), and frees the float chain or the second oversamplers if they are not needed. Not realtime safe, call while not processing,
+   * like Reset(). */
+  void Allocate(bool singlePrecision, bool crossfades)
+  {
+    std::lock_guard<std::mutex> lock(mAllocationMutex);
+    if (!singlePrecision && mSingleAllocated)
+    {
+      for (auto& group : mGroups)
+        group->singleChain.reset();
+      mSingleAllocated = false;
+      mHasSingleChain = false;
+      mProcessingSingle = false;
+    }
+    if (!crossfades && mCrossfadeAllocated)
+    {
+      mCrossfadeAllocated = false;
+      mHasCrossfade = false;
+      mActivePath = 0;
+      mFadeFrames = 0;
+      for (auto& group : mGroups)
+      {
+        group->doubleChain.paths[1].reset();
+        if (group->singleChain)
+          group->singleChain->paths[1].reset();
+        ConfigureActivePaths(*group);
+      }
+    }
+    AddAllocations(singlePrecision, crossfades);
+    AdoptAllocations();
+  }
+
+  /** The number of channels ProcessBlock() handles at most, the groups of SetThreads() are rebuilt for it.
+   * Not realtime safe, call while not processing, like Reset(). */
+  void SetChannels(int nChannels)
+  {
+    nChannels = std::max(nChannels, 1);
+    if (nChannels == mNChannels)
+      return;
+    mNChannels = nChannels;
+    mSingleInputs.resize(nChannels);
+    mSingleOutputs.resize(nChannels);
+    mADAAStates.assign(nChannels, TransferCurveTable::ADAAState());
+    mDryADAAStates.assign(nChannels, TransferCurveTable::ADAAState());
+    ResizeSingleBuffer();
+    BuildGroups();
+  }
+
+  /** Splits the channels into groups of whole channel pairs for nThreads threads, the calling one included, 0 uses one per hardware thread.
+   * Every group has its own oversamplers, so the groups of a block run in parallel once SetThreadsEnabled() allows it and the block carries at
+   * least kMinThreadedFrames oversampled frames, otherwise one after the other on the calling thread. The filters restart from silence.
+   * Not realtime safe, call while not processing, like Reset(). */
+  void SetThreads(int nThreads)
+  {
+    mThreadRequest = nThreads;
+    BuildGroups();
+  }
+  int GetThreads() const { return static_cast<int>(mGroups.size()); }
+
+  /** Allows ProcessBlock() to wait for the threads of SetThreads(), meant for offline rendering. The calling thread blocks on the slowest group,
+   * which a realtime thread must not, so this is off by default. The threads only start when first enabled, which is not realtime safe either,
+   * so instances that never render offline don't keep idle workers around. */
+  void SetThreadsEnabled(bool enabled)
+  {
+    mThreadsEnabled = enabled;
+    if (enabled && !mPool && mGroups.size() > 1)
+      mPool.reset(new ThreadPool(static_cast<int>(mGroups.size()) - 1));
+  }
+
+  /** Samples the output keeps sounding after the input fell below silenceThreshold (in dB), to be reported to the host. The shaper maps 0 to 0,
+   * so only the oversampling filters and ADAA, which delays by up to a sample, ring on. In Auto mode the longest tail of any padded factor. */
+  static int GetTailSize(iplug::EFactor factor, iplug::EFilterType filterType, bool autoOverSampling, int adaaOrder, double silenceThreshold)
+  {
+    return GetFilterTailSize(factor, filterType, autoOverSampling, adaaOrder, iplug::DBToAmp(silenceThreshold)) + (adaaOrder ? 1 : 0);
+  }
+
+  int GetTailSize() const { return GetFilterTailSize(mFactor, mFilterType, mAutoOverSampling, mADAAOrder, mSilenceThreshold) + (mADAAOrder ? 1 : 0); }
+  int NChannels() const { return mNChannels; }
+
+  /** Clears all filter states, blockSize is the largest nFrames passed to ProcessBlock().
+   * The parameters jump to the values set before the next ProcessBlock() instead of ramping. */
+  void Reset(double sampleRate, int blockSize)
+  {
+    {
+      std::lock_guard<std::mutex> lock(mAllocationMutex);
+      mBlockSize = blockSize;
+      for (auto& group : mGroups)
+      {
+        group->doubleChain.Reset(blockSize);
+        if (group->singleChain)
+          group->singleChain->Reset(blockSize);
+      }
+    }
+    mFadeFrames = 0;
+    mCrossfadeFrames = std::max(1, static_cast<int>(kCrossfadeTime * .001 * sampleRate));
+    mAutoHoldLength = static_cast<int>(kAutoHoldTime * .001 * sampleRate);
+    mAutoHoldFrames = 0;
+    ResizeSingleBuffer();
+    for (int c = 0; c < mNChannels; c++)
+      mADAAStates[c] = mDryADAAStates[c] = TransferCurveTable::ADAAState();
+    mSplitTargets.resize(kNumSmoothers * blockSize);
+    mSmoothingFrames = std::max(1, static_cast<int>(kSmoothingTime * .001 * sampleRate));
+    mSmoothingRate = 0;
+    mSettleSmoothers = true;
+    mSilentFrames = 0;
+    mBypassed = false;
+  }
+
+  /** nChans must not exceed the number of channels passed to the constructor or SetChannels(). inputs and outputs may alias. */
+  void ProcessBlock(iplug::sample** inputs, iplug::sample** outputs, int nFrames, int nChans)
+  {
+    ProcessBlock(inputs, outputs, nFrames, nChans, nullptr, 0, [](int) {});
+  }
+
+  /** Same as above with sample accurate parameter changes: atSplit(i) calls the setters of the changes at frame splits[i].
+   * splits must be ascending and inside the block, see BlockOverSampler::ProcessBlock(). The calls to atSplit() happen in order before the block
+   * is processed, only the smoothed parameters (the gains, Wetness, Sync, Pull, Deform and Stages) take effect at their split. */
+  template <typename G>
+  void ProcessBlock(iplug::sample** inputs, iplug::sample** outputs, int nFrames, int nChans, const int* splits, int nSplits, G&& atSplit)
+  {
+    AdoptAllocations();
+    // The chain taking over starts from silence, with nothing to fade from
+    const bool singlePrecision = mSinglePrecision && mHasSingleChain;
+    if (singlePrecision != mProcessingSingle)
+    {
+      mProcessingSingle = singlePrecision;
+      mFadeFrames = 0;
+      for (auto& group : mGroups)
+      {
+        if (singlePrecision)
+          ClearPaths(*group->singleChain);
+        else
+          ClearPaths(group->doubleChain);
+      }
+    }
+
+    // Acquired first so IsSilent() judges the newest shaper, a block that ends up bypassed settles and applies it once processing resumes
+    bool applyShaperValues = mShaper.Acquire();
+
+    // Once the output has rung out silent input only produces silence and isn't processed
+    if (IsSilent(inputs, nFrames, nChans))
+    {
+      if (mSilentFrames >= GetTailSize())
+      {
+        if (!mBypassed)
+        {
+          // What is left in the filters is below the threshold, flushing it also keeps the recursive states from decaying into denormals
+          mBypassed = true;
+          for (auto& group : mGroups)
+            ForEachPath(*group, [](auto& path) { path.Clear(); });
+          for (int c = 0; c < mNChannels; c++)
+            mADAAStates[c] = mDryADAAStates[c] = TransferCurveTable::ADAAState();
+        }
+        for (int c = 0; c < nChans; c++)
+          std::fill(outputs[c], outputs[c] + nFrames, 0.);
+        for (int i = 0; i < nSplits; i++)
+          atSplit(i);
+        return;
+      }
+      mSilentFrames += nFrames;
+    }
+    else
+    {
+      mSilentFrames = 0;
+      if (mBypassed)
+      {
+        mBypassed = false;
+        // Ramps that were due during the silence are over
+        mSettleSmoothers = true;
+      }
+    }
+
+    // Fresh filters after a reset or silence have nothing to fade from
+    UpdateFactor(inputs, nFrames, nChans, mSettleSmoothers);
+
+    // Ramps are counted in samples of the rate the processing runs at
+    const int rate = GetRate();
+    if (rate != mSmoothingRate)
+    {
+      mSmoothingRate = rate;
+      for (auto* smoother : {&mInGain, &mOutGain, &mWetAmp, &mSync, &mPull, &mDeform, &mStages})
+        smoother->SetRampLength(mSmoothingFrames * rate);
+    }
+
+    // A ramping shaper gets its values per sub-block below, a resting one only needs them when it is replaced
+    if (mSettleSmoothers)
+    {
+      for (auto* smoother : {&mInGain, &mOutGain, &mWetAmp, &mSync, &mPull, &mDeform, &mStages})
+        smoother->Settle();
+      mSettleSmoothers = false;
+      applyShaperValues = true;
+    }
+    if (applyShaperValues)
+    {
+      mWorkShaper = mShaper.Get();
+      mWorkShaper.SetQuality(mQuality);
+      mWorkShaper.SetSync(mSync.GetValue());
+      mWorkShaper.SetPull(mPull.GetValue());
+      mWorkShaper.SetDeform(mDeform.GetValue());
+      mWorkShaper.SetStages(mStages.GetValue());
+    }
+
+    const bool tableAcquired = (mCurveTableMode || mADAAOrder) && mCurveTable.Acquire(mShaper.GetAcquiredVersion());
+    mCurveTable.SetInterpolation(mCurveTableMode == 2 ? TransferCurveTable::kCubic : TransferCurveTable::kLinear);
+
+    // Group 0 always runs to carry the parameter state through the block
+    int nGroups = 1;
+    while (nGroups < static_cast<int>(mGroups.size()) && mGroups[nGroups]->firstChannel < nChans)
+      nGroups++;
+    for (int g = 0; g < nGroups; g++)
+      CopyStateTo(*mGroups[g]);
+    RecordSplitTargets(nSplits, atSplit);
+
+    auto processGroup = [&](Group& group) {
+      const int first = group.firstChannel;
+      const int nGroupChans = std::min(group.nChannels, nChans - first);
+      auto replaySplit = [&](int split) {
+        const double* targets = mSplitTargets.data() + split * kNumSmoothers;
+        for (auto* smoother : {&group.inGain, &group.outGain, &group.wetAmp, &group.sync, &group.pull, &group.deform, &group.stages})
+          smoother->SetTarget(*targets++);
+      };
+      if (singlePrecision)
+      {
+        for (int c = first; c < first + nGroupChans; c++)
+          std::copy(inputs[c], inputs[c] + nFrames, mSingleInputs[c]);
+        ProcessPaths(group, *group.singleChain, mSingleInputs.data() + first, mSingleOutputs.data() + first, nFrames, nGroupChans, splits, nSplits,
+                     replaySplit, tableAcquired);
+        for (int c = first; c < first + nGroupChans; c++)
+          std::copy(mSingleOutputs[c], mSingleOutputs[c] + nFrames, outputs[c]);
+      }
+      else
+        ProcessPaths(group, group.doubleChain, inputs + first, outputs + first, nFrames, nGroupChans, splits, nSplits, replaySplit, tableAcquired);
+    };
+
+    // Submit() allocates its std::function and takes the pool's mutexes, which is only fine because no realtime thread gets here
+    if (mPool && mThreadsEnabled && nGroups > 1 && nFrames * GetRate() >= kMinThreadedFrames)
+    {
+      for (int g = 1; g < nGroups; g++)
+      {
+        mPool->Submit([&, g] {
+          // Callers flush denormals, the workers follow suit
+          const iplug::simd::ScopedFlushDenormals flushDenormals;
+          processGroup(*mGroups[g]);
+        });
+      }
+      processGroup(*mGroups[0]);
+      mPool->Wait();
+    }
+    else
+    {
+      for (int g = 0; g < nGroups; g++)
+        processGroup(*mGroups[g]);
+    }
+    CopyStateFrom(*mGroups[0]);
+    mFadeFrames = std::max(mFadeFrames - nFrames, 0);
+  }
+
+private:
+  /** An oversampler followed by a delay, which pads its latency to the one of the Auto mode */
+  template <typename T>
+  struct Path
+  {
+    Path(int nChannels, int blockSize)
+      : oversampler(iplug::EFactor::kNone, nChannels, nChannels, blockSize)
+      , history(nChannels * kMaxPadding)
+    {
+    }
+
+    void Clear()
+    {
+      oversampler.Clear();
+      std::fill(history.begin(), history.end(), T(0));
+    }
+
+    /** Delays the first nChans channels of outputs by padding frames */
+    void Pad(T** outputs, int nFrames, int nChans)
+    {
+      if (!padding)
+        return;
+      for (int c = 0; c < nChans; c++)
+      {
+        T* line = history.data() + c * kMaxPadding;
+        for (int s = 0, pos = position; s < nFrames; s++, pos = (pos + 1) & (kMaxPadding - 1))
+        {
+          const T sample = outputs[c][s];
+          outputs[c][s] = line[(pos - padding) & (kMaxPadding - 1)];
+          line[pos] = sample;
+        }
+      }
+      position = (position + nFrames) & (kMaxPadding - 1);
+    }
+
+    iplug::BlockOverSampler<T> oversampler;
+    std::vector<T> history; // kMaxPadding frames per channel
+    int position = 0;
+    int padding = 0;
+  };
+
+  /** The oversamplers and scratch buffers of one sample type */
+  template <typename T>
+  struct Chain
+  {
+    Chain(int nChannels, int blockSize, bool crossfades)
+      : fadeOutputs(nChannels)
+    {
+      paths[0].reset(new Path<T>(nChannels, blockSize));
+      if (crossfades)
+        paths[1].reset(new Path<T>(nChannels, blockSize));
+      Resize(blockSize);
+    }
+
+    /** Not realtime safe */
+    void Reset(int blockSize)
+    {
+      for (auto& path : paths)
+      {
+        if (path)
+        {
+          path->oversampler.SetBlockSize(blockSize);
+          path->oversampler.Reset();
+          path->Clear();
+        }
+      }
+      Resize(blockSize);
+    }
+
+    void Resize(int blockSize)
+    {
+      for (auto* buffer : {&shaperBuffer, &dryBuffer, &inGainBuffer, &outGainBuffer, &wetAmpBuffer})
+        buffer->Resize(blockSize);
+      fadeBuffer.Resize(static_cast<int>(fadeOutputs.size()) * blockSize);
+      for (size_t c = 0; c < fadeOutputs.size(); c++)
+        fadeOutputs[c] = fadeBuffer.Get() + c * blockSize;
+    }
+
+    // The one at mActivePath produces the output, the other one, allocated by Prepare(), fades out after a change of the factor
+    std::unique_ptr<Path<T>> paths[2];
+    WDL_TypedBuf<T> shaperBuffer;
+    WDL_TypedBuf<T> dryBuffer;
+    WDL_TypedBuf<T> inGainBuffer;
+    WDL_TypedBuf<T> outGainBuffer;
+    WDL_TypedBuf<T> wetAmpBuffer;
+    WDL_TypedBuf<T> fadeBuffer; // the output of the path fading out
+    std::vector<T*> fadeOutputs;
+  };
+
+  /** What the processing of a block advances */
+  struct GroupState
+  {
+    SineWaveshaper shaper;
+    ParamSmoother inGain, outGain, wetAmp, sync, pull, deform, stages;
+  };
+
+  /** Channels processed together: their oversamplers and copies of the state the processing advances, so groups can run on different threads.
+   * Every block starts the groups from the state of the DSP, which takes over the state group 0 ends in. */
+  struct Group : GroupState
+  {
+    Group(int firstChannel, int nChannels, int blockSize, bool singlePrecision, bool crossfades)
+      : firstChannel(firstChannel)
+      , nChannels(nChannels)
+      , doubleChain(nChannels, blockSize, crossfades)
+      , singleChain(singlePrecision ? new Chain<float>(nChannels, blockSize, crossfades) : nullptr)
+      , adaaStates(2 * nChannels)
+    {
+    }
+
+    int firstChannel;
+    int nChannels;
+    Chain<iplug::sample> doubleChain;
+    std::unique_ptr<Chain<float>> singleChain; // allocated by Prepare()
+    std::vector<TransferCurveTable::ADAAState> adaaStates; // those of the channels while the path fading out runs, wet then dry
+  };
+
+  static constexpr int kNumSmoothers = 7;
+  static constexpr int kSilenceLevels = 8; // input levels IsSilent() evaluates the curve at
+
+  void CopyStateTo(Group& group) const
+  {
+    group.shaper = mWorkShaper;
+    group.inGain = mInGain;
+    group.outGain = mOutGain;
+    group.wetAmp = mWetAmp;
+    group.sync = mSync;
+    group.pull = mPull;
+    group.deform = mDeform;
+    group.stages = mStages;
+  }
+
+  void CopyStateFrom(const Group& group)
+  {
+    mWorkShaper = group.shaper;
+    mInGain = group.inGain;
+    mOutGain = group.outGain;
+    mWetAmp = group.wetAmp;
+    mSync = group.sync;
+    mPull = group.pull;
+    mDeform = group.deform;
+    mStages = group.stages;
+  }
+
+  /** Runs atSplit() for every split and keeps the targets it leaves, for the groups to replay at the splits. The smoothers of the DSP end up
+   * with ramps that never happened, CopyStateFrom() overwrites them after the block. */
+  template <typename G>
+  void RecordSplitTargets(int nSplits, G& atSplit)
+  {
+    // Only more splits than frames, which means repeated offsets, can outgrow the size set by Reset()
+    if (nSplits * kNumSmoothers > static_cast<int>(mSplitTargets.size()))
+      mSplitTargets.resize(nSplits * kNumSmoothers);
+    double* targets = mSplitTargets.data();
+    for (int i = 0; i < nSplits; i++)
+    {
+      atSplit(i);
+      for (auto* smoother : {&mInGain, &mOutGain, &mWetAmp, &mSync, &mPull, &mDeform, &mStages})
+        *targets++ = smoother->GetTarget();
+    }
+  }
+
+  /** Chooses the factor of the block and switches the paths over to it. A switch waits for the fade of the previous one to end. */
+  void UpdateFactor(iplug::sample** inputs, int nFrames, int nChans, bool fresh)
+  {
+    iplug::EFactor factor = mRequestedFactor;
+    if (mAutoOverSampling)
+    {
+      iplug::sample peak = 0.;
+      for (int c = 0; c < nChans; c++)
+        for (int s = 0; s < nFrames; s++)
+          peak = std::max(peak, std::abs(inputs[c][s]));
+      // The smoothed parameters count where they are heading, so the factor is up before the curve gets there
+      const SineWaveshaper& shaper = mShaper.Get();
+      const iplug::EFactor recommended =
+        aliasmap::GetRecommendedFactor(mFilterType, shaper.GetPreClip(), shaper.GetPostClip(), shaper.GetAlgorithm(), mSync.GetTarget(), mPull.GetTarget(),
+                                       mDeform.GetTarget(), mStages.GetTarget(), std::max(iplug::AmpToDB(peak * mInGain.GetTarget()), aliasmap::kDrives[0]));
+      if (recommended >= mAutoFactor || mAutoHoldFrames <= 0)
+      {
+        mAutoFactor = recommended;
+        mAutoHoldFrames = mAutoHoldLength;
+      }
+      else
+        mAutoHoldFrames -= nFrames;
+      factor = mAutoFactor;
+    }
+
+    if (factor == mFactor || (mFadeFrames && !fresh))
+      return;
+    // Auto pads every factor to one latency. A manual change of the latency makes the host realign the output, a fade between the misaligned
+    // paths would only smear that into a comb filter, so it switches at once like a change of the filter type.
+    const bool aligned = GetPathLatency(factor, mFilterType, mADAAOrder) + GetPadding(factor) == GetPathLatency(mFactor, mFilterType, mADAAOrder) + GetPadding(mFactor);
+    mFactor = factor;
+    // Without the second paths the active ones switch at once
+    if (mHasCrossfade)
+    {
+      mActivePath = 1 - mActivePath;
+      mFadeFrames = fresh || !aligned ? 0 : mCrossfadeFrames;
+    }
+    for (auto& group : mGroups)
+      ConfigureActivePaths(*group);
+  }
+
+  /** Sets the active path of every chain of group the audio thread has taken over to the current factor and filters */
+  void ConfigureActivePaths(Group& group)
+  {
+    ConfigurePath(*group.doubleChain.paths[mActivePath]);
+    if (mHasSingleChain)
+      ConfigurePath(*group.singleChain->paths[mActivePath]);
+  }
+
+  /** A path taking over starts from silence at the current factor */
+  template <typename T>
+  void ConfigurePath(Path<T>& path)
+  {
+    path.oversampler.SetFilterType(mFilterType);
+    path.oversampler.SetOverSampling(mFactor);
+    path.padding = GetPadding(mFactor);
+    path.Clear();
+  }
+
+  /** The latency of a path before its padding */
+  static int GetPathLatency(iplug::EFactor factor, iplug::EFilterType filterType, int adaaOrder)
+  {
+    return iplug::BlockOverSampler<iplug::sample>::GetLatency(factor, filterType) + GetADAALatency(factor, adaaOrder);
+  }
+
+  int GetPadding(iplug::EFactor factor) const
+  {
+    const int padding = mAutoOverSampling ? GetAutoLatency(mFilterType, mADAAOrder) - GetPathLatency(factor, mFilterType, mADAAOrder) : 0;
+    assert(padding < kMaxPadding);
+    return padding;
+  }
+
+  /** The new delays apply at once, which clicks like the change of the filter type or the Auto mode that calls for them */
+  void UpdatePaddings()
+  {
+    for (auto& group : mGroups)
+      ForEachPath(*group, [this](auto& path) { path.padding = GetPadding(path.oversampler.GetFactor()); });
+  }
+
+  int GetPathCount() const { return mHasCrossfade ? 2 : 1; }
+
+  /** Calls func for every path of group the audio thread has taken over */
+  template <typename F>
+  void ForEachPath(Group& group, F&& func)
+  {
+    for (int i = 0; i < GetPathCount(); i++)
+    {
+      func(*group.doubleChain.paths[i]);
+      if (mHasSingleChain)
+        func(*group.singleChain->paths[i]);
+    }
+  }
+
+  template <typename T>
+  void ClearPaths(Chain<T>& chain)
+  {
+    for (int i = 0; i < GetPathCount(); i++)
+      chain.paths[i]->Clear();
+  }
+
+  /** The allocations of Prepare(), the caller holds mAllocationMutex. The second paths come first, so a float chain allocated after them has
+   * its second path as well. */
+  void AddAllocations(bool singlePrecision, bool crossfades)
+  {
+    if (crossfades && !mCrossfadeAllocated)
+    {
+      for (auto& group : mGroups)
+      {
+        group->doubleChain.paths[1].reset(new Path<iplug::sample>(group->nChannels, mBlockSize));
+        if (mSingleAllocated)
+          group->singleChain->paths[1].reset(new Path<float>(group->nChannels, mBlockSize));
+      }
+      mCrossfadeAllocated = true;
+    }
+    if (singlePrecision && !mSingleAllocated)
+    {
+      for (auto& group : mGroups)
+        group->singleChain.reset(new Chain<float>(group->nChannels, mBlockSize, mCrossfadeAllocated));
+      mSingleAllocated = true;
+    }
+  }
+
+  /** The audio thread takes over what Prepare() allocated. The second paths are configured when they become active. */
+  void AdoptAllocations()
+  {
+    if (!mHasCrossfade && mCrossfadeAllocated)
+      mHasCrossfade = true;
+    if (!mHasSingleChain && mSingleAllocated)
+    {
+      mHasSingleChain = true;
+      for (auto& group : mGroups)
+        ConfigurePath(*group->singleChain->paths[mActivePath]);
+    }
+  }
+
+  /** Splits the channels as SetThreads() asked for, unless the groups are split that way already */
+  void BuildGroups()
+  {
+    int nThreads = mThreadRequest;
+    if (nThreads <= 0)
+      nThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int nPairs = (mNChannels + 1) / 2;
+    nThreads = std::max(1, std::min(nThreads, nPairs));
+    const int groupSize = 2 * ((nPairs + nThreads - 1) / nThreads);
+    const int nGroups = (mNChannels + groupSize - 1) / groupSize;
+    if (nGroups == static_cast<int>(mGroups.size()) && mGroups[0]->nChannels == std::min(groupSize, mNChannels) &&
+        mGroups.back()->firstChannel + mGroups.back()->nChannels == mNChannels)
+      return;
+
+    {
+      std::lock_guard<std::mutex> lock(mAllocationMutex);
+      mGroups.clear();
+      for (int first = 0; first < mNChannels; first += groupSize)
+        mGroups.emplace_back(new Group(first, std::min(groupSize, mNChannels - first), mBlockSize, mSingleAllocated, mCrossfadeAllocated));
+    }
+    for (auto& group : mGroups)
+      ConfigureActivePaths(*group);
+    mFadeFrames = 0;
+    mPool.reset();
+    SetThreadsEnabled(mThreadsEnabled);
+  }
+
+  void ResizeSingleBuffer()
+  {
+    mSingleBuffer.Resize(2 * mNChannels * mBlockSize);
+    for (int c = 0; c < mNChannels; c++)
+    {
+      mSingleInputs[c] = mSingleBuffer.Get() + c * mBlockSize;
+      mSingleOutputs[c] = mSingleBuffer.Get() + (mNChannels + c) * mBlockSize;
+    }
+  }
+
+  static int GetFilterTailSize(iplug::EFactor factor, iplug::EFilterType filterType, bool autoOverSampling, int adaaOrder, double threshold)
+  {
+    using OverSampler = iplug::BlockOverSampler<iplug::sample>;
+    if (!autoOverSampling)
+      return OverSampler::GetTailSize(factor, filterType, threshold);
+    int tail = 0;
+    for (int f = 0; f < iplug::kNumFactors; f++)
+    {
+      const auto candidate = static_cast<iplug::EFactor>(f);
+      tail = std::max(tail, OverSampler::GetTailSize(candidate, filterType, threshold) + GetAutoLatency(filterType, adaaOrder) - GetPathLatency(candidate, filterType, adaaOrder));
+    }
+    return tail;
+  }
+
+  /** While a change of the factor fades, the path fading out processes the block from a copy of the state first, then the active one continues
+   * from the original state, so the fade doesn't advance the parameters or ADAA twice. The channels of inputs and outputs start at the first
+   * one of group, inputs and outputs may alias. */
+  template <typename T, typename G>
+  void ProcessPaths(Group& group, Chain<T>& chain, T** inputs, T** outputs, int nFrames, int nChans, const int* splits, int nSplits, G& atSplit, bool tableAcquired)
+  {
+    Path<T>& active = *chain.paths[mActivePath];
+    if (!mFadeFrames)
+    {
+      ProcessChain(group, chain, active, inputs, outputs, nFrames, nChans, splits, nSplits, atSplit, tableAcquired);
+      return;
+    }
+
+    const GroupState start = group;
+    const int first = group.firstChannel;
+    std::copy(mADAAStates.begin() + first, mADAAStates.begin() + first + nChans, group.adaaStates.begin());
+    std::copy(mDryADAAStates.begin() + first, mDryADAAStates.begin() + first + nChans, group.adaaStates.begin() + group.nChannels);
+    T** fading = chain.fadeOutputs.data();
+    ProcessChain(group, chain, *chain.paths[1 - mActivePath], inputs, fading, nFrames, nChans, splits, nSplits, atSplit, tableAcquired);
+    static_cast<GroupState&>(group) = start;
+    std::copy(group.adaaStates.begin(), group.adaaStates.begin() + nChans, mADAAStates.begin() + first);
+    std::copy(group.adaaStates.begin() + group.nChannels, group.adaaStates.begin() + group.nChannels + nChans, mDryADAAStates.begin() + first);
+    ProcessChain(group, chain, active, inputs, outputs, nFrames, nChans, splits, nSplits, atSplit, tableAcquired);
+
+    // Both paths carry the same signal, a linear fade keeps its level
+    const int done = mCrossfadeFrames - mFadeFrames;
+    const T step = static_cast<T>(1. / mCrossfadeFrames);
+    for (int c = 0; c < nChans; c++)
+    {
+      for (int s = 0; s < nFrames; s++)
+      {
+        const T gain = std::min(static_cast<T>(done + s + 1) * step, T(1));
+        outputs[c][s] = fading[c][s] + (outputs[c][s] - fading[c][s]) * gain;
+      }
+    }
+  }
+
+  /** The channels of inputs and outputs start at the first one of group */
+  template <typename T, typename G>
+  void ProcessChain(Group& group, Chain<T>& chain, Path<T>& path, T** inputs, T** outputs, int nFrames, int nChans, const int* splits, int nSplits, G& atSplit,
+                    bool tableAcquired)
+  {
+    auto processFunc = [&](T** osinputs, T** osoutputs, int osnFrames) {
+      // The curve table mode only uses the table while the parameters rest where it was built for, ADAA also while they ramp towards it
+      const bool tableReady = tableAcquired && !IsShaperSmoothing(group) && MatchesShaper(group.shaper, mShaper.Get());
+
+      // Per sample gains only while a gain ramps, otherwise the constant paths below
+      const bool smoothGains = group.inGain.IsSmoothing() || group.outGain.IsSmoothing() || group.wetAmp.IsSmoothing();
+      if (smoothGains)
+      {
+        group.inGain.Process(chain.inGainBuffer.Get(), osnFrames);
+        group.outGain.Process(chain.outGainBuffer.Get(), osnFrames);
+        group.wetAmp.Process(chain.wetAmpBuffer.Get(), osnFrames);
+      }
+
+      // Only a moving shaper is worth splitting the block for
+      const int subBlockSize = IsShaperSmoothing(group) ? kShaperSubBlockSize : osnFrames;
+      for (int start = 0; start < osnFrames; start += subBlockSize)
+      {
+        const int n = std::min(subBlockSize, osnFrames - start);
+        if (IsShaperSmoothing(group))
+        {
+          group.shaper.SetSync(group.sync.Skip(n));
+          group.shaper.SetPull(group.pull.Skip(n));
+          group.shaper.SetDeform(group.deform.Skip(n));
+          group.shaper.SetStages(group.stages.Skip(n));
+        }
+        for (int c = 0; c < nChans; c++)
+          ProcessChannel(group, chain, osinputs[c] + start, osoutputs[c] + start, start, n, group.firstChannel + c, smoothGains, tableReady,
+                         tableAcquired);
+      }
+    };
+
+    path.oversampler.ProcessBlock(inputs, outputs, nFrames, nChans, nChans, processFunc, splits, nSplits, atSplit);
+    path.Pad(outputs, nFrames, nChans);
+  }
+
+  static bool IsShaperSmoothing(const Group& group)
+  {
+    return group.sync.IsSmoothing() || group.pull.IsSmoothing() || group.deform.IsSmoothing() || group.stages.IsSmoothing();
+  }
+
+  /** Whether the output of the block stays below the silence threshold. Quiet input alone doesn't tell, the shaper can raise it by 100dB
+   * (Pull 0.25 brings -120dB to about -20dB), so the peak of input below the threshold goes through the curve at the parameter targets, with the
+   * louder of value and target of every gain. The curve may fold back below the peak, so it is evaluated at kSilenceLevels levels an octave apart. */
+  bool IsSilent(iplug::sample** inputs, int nFrames, int nChans) const
+  {
+    double peak = 0.;
+    for (int c = 0; c < nChans; c++)
+    {
+      for (int s = 0; s < nFrames; s++)
+      {
+        const double sample = std::abs(inputs[c][s]);
+        if (sample > mSilenceThreshold)
+          return false;
+        peak = std::max(peak, sample);
+      }
+    }
+    if (peak == 0.)
+      return true;
+
+    SineWaveshaper shaper = mShaper.Get();
+    shaper.SetSync(mSync.GetTarget());
+    shaper.SetPull(mPull.GetTarget());
+    shaper.SetDeform(mDeform.GetTarget());
+    shaper.SetStages(mStages.GetTarget());
+    const double x = peak * std::max(mInGain.GetValue(), mInGain.GetTarget());
+    double shaped = 0.;
+    for (int i = 0; i < kSilenceLevels; i++)
+      shaped = std::max(shaped, std::abs(shaper.ProcessSample(std::ldexp(x, -i))));
+    const double wetAmp = std::max(mWetAmp.GetValue(), mWetAmp.GetTarget());
+    const double dryAmp = 1. - std::min(mWetAmp.GetValue(), mWetAmp.GetTarget());
+    return peak * dryAmp + shaped * std::max(mOutGain.GetValue(), mOutGain.GetTarget()) * wetAmp <= mSilenceThreshold;
+  }
+
+  static bool MatchesShaper(const SineWaveshaper& a, const SineWaveshaper& b)
+  {
+    return a.GetSync() == b.GetSync() && a.GetPull() == b.GetPull() && a.GetDeform() == b.GetDeform() && a.GetStages() == b.GetStages();
+  }
+
+  /** n samples of channel c, offset samples into the gain ramps */
+  template <typename T>
+  void ProcessChannel(const Group& group, Chain<T>& chain, const T* in, T* out, int offset, int n, int c, bool smoothGains, bool tableReady,
+                      bool tableAcquired)
+  {
+    T* shaped = chain.shaperBuffer.Get();
+    T* dry = chain.dryBuffer.Get();
+    const SineWaveshaper& shaper = group.shaper;
+
+    if (smoothGains)
+    {
+      const T* inGain = chain.inGainBuffer.Get() + offset;
+      for (int s = 0; s < n; s++)
+        shaped[s] = in[s] * inGain[s];
+    }
+    else
+    {
+      const T inGain = static_cast<T>(group.inGain.GetValue());
+      for (int s = 0; s < n; s++)
+        shaped[s] = in[s] * inGain;
+    }
+
+    if (mADAAOrder)
+    {
+      // ADAA delays the wet signal by half a sample per order, the dry signal gets the same delay to stay aligned
+      if (tableAcquired)
+        mCurveTable.ProcessBlockADAA(mADAAOrder, shaper, shaped, shaped, n, mADAAStates[c]);
+      else
+      {
+        TransferCurveTable::DelayLikeADAA(mADAAOrder, shaped, shaped, n, mADAAStates[c]);
+        shaper.ProcessBlock(shaped, shaped, n);
+      }
+      TransferCurveTable::DelayLikeADAA(mADAAOrder, in, dry, n, mDryADAAStates[c]);
+      in = dry;
+    }
+    else if (mCurveTableMode && tableReady)
+      mCurveTable.ProcessBlock(shaper, shaped, shaped, n);
+    else
+      shaper.ProcessBlock(shaped, shaped, n);
+
+    if (smoothGains)
+    {
+      const T* outGain = chain.outGainBuffer.Get() + offset;
+      const T* wetAmp = chain.wetAmpBuffer.Get() + offset;
+      for (int s = 0; s < n; s++)
+        out[s] = in[s] * (1 - wetAmp[s]) + shaped[s] * (outGain[s] * wetAmp[s]);
+    }
+    else
+    {
+      const T dryAmp = static_cast<T>(1. - group.wetAmp.GetValue());
+      const T wetAmp = static_cast<T>(group.outGain.GetValue() * group.wetAmp.GetValue());
+      for (int s = 0; s < n; s++)
+        out[s] = in[s] * dryAmp + shaped[s] * wetAmp;
+    }
+  }
+
+  int mNChannels;
+  int mBlockSize;
+  SnapshotBuffer<SineWaveshaper> mShaper;
+  SineWaveshaper mWorkShaper; // the acquired shaper with the smoothed parameters
+  TransferCurveTable mCurveTable;
+  std::mutex mCurveTableMutex; // between the threads calling UpdateCurveTable()
+  std::vector<std::unique_ptr<Group>> mGroups;
+  int mThreadRequest = 1; // by SetThreads()
+  std::mutex mAllocationMutex; // between Prepare() and the other non-realtime methods that change the chains
+  std::atomic<bool> mSingleAllocated{false}; // the float chains of Prepare(), set once they are complete
+  std::atomic<bool> mCrossfadeAllocated{false}; // the second paths of Prepare(), set once they are complete
+  bool mHasSingleChain = false; // the allocations the audio thread has taken over
+  bool mHasCrossfade = false;
+  bool mProcessingSingle = false; // the chain of the last block
+  std::unique_ptr<ThreadPool> mPool; // one thread less than groups, the calling thread processes group 0, created by SetThreadsEnabled()
+  bool mThreadsEnabled = false;
+  iplug::EFactor mRequestedFactor = iplug::EFactor::kNone; // by SetOverSampling()
+  iplug::EFactor mFactor = iplug::EFactor::kNone; // of the active paths
+  iplug::EFilterType mFilterType = iplug::EFilterType::kHalfbandIIR;
+  int mActivePath = 0;
+  int mFadeFrames = 0; // left of the fade from the other path
+  int mCrossfadeFrames = 1;
+  bool mAutoOverSampling = false;
+  iplug::EFactor mAutoFactor = iplug::EFactor::kNone;
+  int mAutoHoldFrames = 0; // until a lower recommendation can take over
+  int mAutoHoldLength = 0;
+  std::vector<double> mSplitTargets; // kNumSmoothers targets per split, in the order of RecordSplitTargets()
+  WDL_TypedBuf<float> mSingleBuffer; // the block converted to float, inputs then outputs
+  std::vector<float*> mSingleInputs;
+  std::vector<float*> mSingleOutputs;
+  bool mSinglePrecision = false;
+  SineWaveshaper::EQuality mQuality = SineWaveshaper::kHigh;
+  std::vector<TransferCurveTable::ADAAState> mADAAStates;
+  std::vector<TransferCurveTable::ADAAState> mDryADAAStates;
+  ParamSmoother mInGain{1.};
+  ParamSmoother mOutGain{1.};
+  ParamSmoother mWetAmp{1.};
+  ParamSmoother mSync{1.};
+  ParamSmoother mPull{1.};
+  ParamSmoother mDeform{1.};
+  ParamSmoother mStages{1.};
+  double mSilenceThreshold = iplug::DBToAmp(kDefaultSilenceThreshold);
+  int mSilentFrames = 0; // consecutive silent input frames, counted up to the tail
+  bool mBypassed = false;
+  int mSmoothingFrames = 1;
+  int mSmoothingRate = 0;
+  bool mSettleSmoothers = true;
+  int mCurveTableMode = 0;
+  int mADAAOrder = 0;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "BlockOversampler.h"
+#include "SineWaveshaper.h"
+#include <algorithm>
+
+// Kept free of plugin headers so the headless tools can address parameters and states by index
+enum EParams
+{
+  kAlgorithm = 0,
+  kSync,
+  kPull,
+  kDeform,
+  kStages,
+  kPreClip,
+  kPostClip,
+  kInputGain,
+  kOutputGain,
+  kWetness,
+  kOverSample,
+  kOverSampleOnline,
+  kOverSampleOffline,
+  kCurveTable,
+  kAntiAlias,
+  kOverSampleFilter,
+  kSilenceThreshold,
+  kPrecision,
+  kQuality,
+  kQualityOffline,
+  kNumParams
+};
+
+// The kOverSampleOnline value of "Auto", after the factors; kOverSampleOffline has it one higher
+constexpr int kOverSampleAuto = iplug::kNumFactors;
+
+/** The kOverSampleOnline value in use from the kOverSampleOnline and kOverSampleOffline values */
+inline int GetOverSamplingChoice(int online, int offline, bool renderingOffline)
+{
+  // The render setting starts with "Same as real-time"
+  return renderingOffline && offline ? offline - 1 : online;
+}
+
+/** Whether the DSP picks the factor itself, see RCSinerDSP::SetAutoOverSampling() */
+inline bool IsOverSamplingAuto(bool oversample, int online, int offline, bool renderingOffline)
+{
+  return oversample && GetOverSamplingChoice(online, offline, renderingOffline) == kOverSampleAuto;
+}
+
+/** The oversampling factor in use from the kOverSample, kOverSampleOnline and kOverSampleOffline values, 16x for Auto, the most it picks */
+inline iplug::EFactor GetOverSamplingFactor(bool oversample, int online, int offline, bool renderingOffline)
+{
+  if (!oversample)
+    return iplug::EFactor::kNone;
+  return static_cast<iplug::EFactor>(std::min(GetOverSamplingChoice(online, offline, renderingOffline), static_cast<int>(iplug::EFactor::k16x)));
+}
+
+/** The shaper quality in use from the kQuality and kQualityOffline values */
+inline SineWaveshaper::EQuality GetShaperQuality(int online, int offline, bool renderingOffline)
+{
+  // The render setting starts with "Same as real-time" as well
+  if (renderingOffline && offline)
+    return static_cast<SineWaveshaper::EQuality>(offline - 1);
+  return static_cast<SineWaveshaper::EQuality>(online);
+}
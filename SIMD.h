@@ -0,0 +1,608 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "IPlugPlatform.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+  #define SIMD_X86 1
+  #include <immintrin.h>
+  #if defined(__GNUC__) || defined(__clang__)
+    #define SIMD_TARGET_AVX2 __attribute__((target("avx2,fma")))
+    #define SIMD_FLATTEN __attribute__((flatten))
+  #else
+    #include <intrin.h>
+    #define SIMD_TARGET_AVX2
+    #define SIMD_FLATTEN
+  #endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+  #define SIMD_NEON 1
+  #include <arm_neon.h>
+  #if defined(_MSC_VER) && !defined(__clang__)
+    #include <float.h>
+  #endif
+#endif
+
+BEGIN_IPLUG_NAMESPACE
+namespace simd
+{
+enum class ELevel
+{
+  kScalar = 0,
+  kSSE2,
+  kAVX2,
+  kNEON
+};
+
+/** Best instruction set available on the running CPU. SSE2 and NEON are part of the x86-64 and AArch64 baselines, AVX2 (+FMA) is detected once at runtime. */
+static inline ELevel GetLevel()
+{
+#if defined SIMD_X86
+  static const ELevel level = []() {
+  #if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    const bool hasAVX2 = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+  #else
+    int info[4];
+    __cpuid(info, 1);
+    const bool hasFMA = (info[2] & (1 << 12)) != 0;
+    const bool hasOSXSAVE = (info[2] & (1 << 27)) != 0;
+    const bool hasOSYMM = hasOSXSAVE && (_xgetbv(0) & 0x6) == 0x6;
+    __cpuidex(info, 7, 0);
+    const bool hasAVX2 = hasFMA && hasOSYMM && (info[1] & (1 << 5)) != 0;
+  #endif
+    return hasAVX2 ? ELevel::kAVX2 : ELevel::kSSE2;
+  }();
+  return level;
+#elif defined SIMD_NEON
+  return ELevel::kNEON;
+#else
+  return ELevel::kScalar;
+#endif
+}
+
+/** Makes the current thread flush denormal results to zero and treat denormal operands as zero until it goes out of scope, then restores the
+ * previous mode. Arithmetic on denormals takes a slow path on most CPUs, and the states of decaying recursive filters end up there.
+ * Sets FTZ and DAZ of the MXCSR on x86 (the x87 unit of 32 bit builds without SSE2 is unaffected) and FZ of the FPCR on AArch64. */
+class ScopedFlushDenormals
+{
+public:
+  ScopedFlushDenormals()
+  {
+#if defined SIMD_X86
+    mPrevious = _mm_getcsr();
+    _mm_setcsr(static_cast<unsigned int>(mPrevious) | kFTZ | kDAZ);
+#elif defined SIMD_NEON
+    mPrevious = GetFPCR();
+    SetFPCR(mPrevious | kFZ);
+#endif
+  }
+
+  ~ScopedFlushDenormals()
+  {
+#if defined SIMD_X86
+    _mm_setcsr(static_cast<unsigned int>(mPrevious));
+#elif defined SIMD_NEON
+    SetFPCR(mPrevious);
+#endif
+  }
+
+  ScopedFlushDenormals(const ScopedFlushDenormals&) = delete;
+  ScopedFlushDenormals& operator=(const ScopedFlushDenormals&) = delete;
+
+private:
+#if defined SIMD_X86
+  static constexpr unsigned int kFTZ = 0x8000;
+  static constexpr unsigned int kDAZ = 0x0040;
+#elif defined SIMD_NEON
+  static constexpr uint64_t kFZ = 1ULL << 24;
+
+  // MSVC has no inline assembly on ARM64, its CRT maps the denormal control onto FZ
+  static uint64_t GetFPCR()
+  {
+  #if defined(_MSC_VER) && !defined(__clang__)
+    unsigned int control;
+    _controlfp_s(&control, 0, 0);
+    return (control & _MCW_DN) == _DN_FLUSH ? kFZ : 0;
+  #else
+    uint64_t fpcr;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(fpcr));
+    return fpcr;
+  #endif
+  }
+
+  static void SetFPCR(uint64_t fpcr)
+  {
+  #if defined(_MSC_VER) && !defined(__clang__)
+    unsigned int control;
+    _controlfp_s(&control, (fpcr & kFZ) ? _DN_FLUSH : _DN_SAVE, _MCW_DN);
+  #else
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(fpcr));
+  #endif
+  }
+#endif
+
+  uint64_t mPrevious = 0;
+};
+
+/** Portable fallback with the same interface as the vector types below, one lane wide */
+struct ScalarD
+{
+  using Scalar = double;
+  static constexpr int kSize = 1;
+  double v;
+
+  static ScalarD Load(const double* p) { return {*p}; }
+  void Store(double* p) const { *p = v; }
+  static ScalarD Set(double s) { return {s}; }
+
+  friend ScalarD operator+(ScalarD a, ScalarD b) { return {a.v + b.v}; }
+  friend ScalarD operator-(ScalarD a, ScalarD b) { return {a.v - b.v}; }
+  friend ScalarD operator*(ScalarD a, ScalarD b) { return {a.v * b.v}; }
+  friend ScalarD operator/(ScalarD a, ScalarD b) { return {a.v / b.v}; }
+
+  static ScalarD MulAdd(ScalarD a, ScalarD b, ScalarD c) { return {a.v * b.v + c.v}; }
+  static ScalarD Min(ScalarD a, ScalarD b) { return {b.v < a.v ? b.v : a.v}; }
+  static ScalarD Max(ScalarD a, ScalarD b) { return {a.v < b.v ? b.v : a.v}; }
+
+  static ScalarD And(ScalarD a, ScalarD b) { return FromBits(Bits(a) & Bits(b)); }
+  static ScalarD Or(ScalarD a, ScalarD b) { return FromBits(Bits(a) | Bits(b)); }
+  static ScalarD Xor(ScalarD a, ScalarD b) { return FromBits(Bits(a) ^ Bits(b)); }
+  static ScalarD AndNot(ScalarD a, ScalarD b) { return FromBits(~Bits(a) & Bits(b)); }
+  static ScalarD Abs(ScalarD a) { return FromBits(Bits(a) & ~kSignMask); }
+  static ScalarD SignBit(ScalarD a) { return FromBits(Bits(a) & kSignMask); }
+
+  static ScalarD CmpEq(ScalarD a, ScalarD b) { return Mask(a.v == b.v); }
+  static ScalarD CmpLt(ScalarD a, ScalarD b) { return Mask(a.v < b.v); }
+  static ScalarD CmpLe(ScalarD a, ScalarD b) { return Mask(a.v <= b.v); }
+  static ScalarD CmpGt(ScalarD a, ScalarD b) { return Mask(a.v > b.v); }
+  static ScalarD Select(ScalarD mask, ScalarD a, ScalarD b) { return Bits(mask) ? a : b; }
+  static bool AllTrue(ScalarD mask) { return Bits(mask) != 0; }
+  static bool AnyTrue(ScalarD mask) { return Bits(mask) != 0; }
+
+  static ScalarD Round(ScalarD a) { return {std::nearbyint(a.v)}; }
+  static ScalarD Ldexp2(ScalarD n) { return FromBits(static_cast<uint64_t>(static_cast<int64_t>(n.v) + 1023) << 52); }
+  static ScalarD Exponent(ScalarD a) { return {static_cast<double>(static_cast<int64_t>((Bits(a) >> 52) & 0x7ff) - 1023)}; }
+  static ScalarD Mantissa(ScalarD a) { return FromBits((Bits(a) & 0x000fffffffffffffULL) | 0x3ff0000000000000ULL); }
+
+private:
+  static constexpr uint64_t kSignMask = 0x8000000000000000ULL;
+  static uint64_t Bits(ScalarD a)
+  {
+    uint64_t b;
+    std::memcpy(&b, &a.v, sizeof(b));
+    return b;
+  }
+  static ScalarD FromBits(uint64_t b)
+  {
+    ScalarD a;
+    std::memcpy(&a.v, &b, sizeof(b));
+    return a;
+  }
+  static ScalarD Mask(bool m) { return FromBits(m ? ~0ULL : 0ULL); }
+};
+
+/** Single precision counterpart of ScalarD */
+struct ScalarF
+{
+  using Scalar = float;
+  static constexpr int kSize = 1;
+  float v;
+
+  static ScalarF Load(const float* p) { return {*p}; }
+  void Store(float* p) const { *p = v; }
+  static ScalarF Set(float s) { return {s}; }
+
+  friend ScalarF operator+(ScalarF a, ScalarF b) { return {a.v + b.v}; }
+  friend ScalarF operator-(ScalarF a, ScalarF b) { return {a.v - b.v}; }
+  friend ScalarF operator*(ScalarF a, ScalarF b) { return {a.v * b.v}; }
+  friend ScalarF operator/(ScalarF a, ScalarF b) { return {a.v / b.v}; }
+
+  static ScalarF MulAdd(ScalarF a, ScalarF b, ScalarF c) { return {a.v * b.v + c.v}; }
+  static ScalarF Min(ScalarF a, ScalarF b) { return {b.v < a.v ? b.v : a.v}; }
+  static ScalarF Max(ScalarF a, ScalarF b) { return {a.v < b.v ? b.v : a.v}; }
+
+  static ScalarF And(ScalarF a, ScalarF b) { return FromBits(Bits(a) & Bits(b)); }
+  static ScalarF Or(ScalarF a, ScalarF b) { return FromBits(Bits(a) | Bits(b)); }
+  static ScalarF Xor(ScalarF a, ScalarF b) { return FromBits(Bits(a) ^ Bits(b)); }
+  static ScalarF AndNot(ScalarF a, ScalarF b) { return FromBits(~Bits(a) & Bits(b)); }
+  static ScalarF Abs(ScalarF a) { return FromBits(Bits(a) & ~kSignMask); }
+  static ScalarF SignBit(ScalarF a) { return FromBits(Bits(a) & kSignMask); }
+
+  static ScalarF CmpEq(ScalarF a, ScalarF b) { return Mask(a.v == b.v); }
+  static ScalarF CmpLt(ScalarF a, ScalarF b) { return Mask(a.v < b.v); }
+  static ScalarF CmpLe(ScalarF a, ScalarF b) { return Mask(a.v <= b.v); }
+  static ScalarF CmpGt(ScalarF a, ScalarF b) { return Mask(a.v > b.v); }
+  static ScalarF Select(ScalarF mask, ScalarF a, ScalarF b) { return Bits(mask) ? a : b; }
+  static bool AllTrue(ScalarF mask) { return Bits(mask) != 0; }
+  static bool AnyTrue(ScalarF mask) { return Bits(mask) != 0; }
+
+  static ScalarF Round(ScalarF a) { return {std::nearbyint(a.v)}; }
+  static ScalarF Ldexp2(ScalarF n) { return FromBits(static_cast<uint32_t>(static_cast<int32_t>(n.v) + 127) << 23); }
+  static ScalarF Exponent(ScalarF a) { return {static_cast<float>(static_cast<int32_t>((Bits(a) >> 23) & 0xff) - 127)}; }
+  static ScalarF Mantissa(ScalarF a) { return FromBits((Bits(a) & 0x007fffffU) | 0x3f800000U); }
+
+private:
+  static constexpr uint32_t kSignMask = 0x80000000U;
+  static uint32_t Bits(ScalarF a)
+  {
+    uint32_t b;
+    std::memcpy(&b, &a.v, sizeof(b));
+    return b;
+  }
+  static ScalarF FromBits(uint32_t b)
+  {
+    ScalarF a;
+    std::memcpy(&a.v, &b, sizeof(b));
+    return a;
+  }
+  static ScalarF Mask(bool m) { return FromBits(m ? ~0U : 0U); }
+};
+
+#if defined SIMD_X86
+struct SSE2D
+{
+  using Scalar = double;
+  static constexpr int kSize = 2;
+  __m128d v;
+
+  static SSE2D Load(const double* p) { return {_mm_loadu_pd(p)}; }
+  void Store(double* p) const { _mm_storeu_pd(p, v); }
+  static SSE2D Set(double s) { return {_mm_set1_pd(s)}; }
+
+  friend SSE2D operator+(SSE2D a, SSE2D b) { return {_mm_add_pd(a.v, b.v)}; }
+  friend SSE2D operator-(SSE2D a, SSE2D b) { return {_mm_sub_pd(a.v, b.v)}; }
+  friend SSE2D operator*(SSE2D a, SSE2D b) { return {_mm_mul_pd(a.v, b.v)}; }
+  friend SSE2D operator/(SSE2D a, SSE2D b) { return {_mm_div_pd(a.v, b.v)}; }
+
+  static SSE2D MulAdd(SSE2D a, SSE2D b, SSE2D c) { return {_mm_add_pd(_mm_mul_pd(a.v, b.v), c.v)}; }
+  static SSE2D Min(SSE2D a, SSE2D b) { return {_mm_min_pd(a.v, b.v)}; }
+  static SSE2D Max(SSE2D a, SSE2D b) { return {_mm_max_pd(a.v, b.v)}; }
+
+  static SSE2D And(SSE2D a, SSE2D b) { return {_mm_and_pd(a.v, b.v)}; }
+  static SSE2D Or(SSE2D a, SSE2D b) { return {_mm_or_pd(a.v, b.v)}; }
+  static SSE2D Xor(SSE2D a, SSE2D b) { return {_mm_xor_pd(a.v, b.v)}; }
+  static SSE2D AndNot(SSE2D a, SSE2D b) { return {_mm_andnot_pd(a.v, b.v)}; }
+  static SSE2D Abs(SSE2D a) { return {_mm_andnot_pd(_mm_set1_pd(-0.), a.v)}; }
+  static SSE2D SignBit(SSE2D a) { return {_mm_and_pd(_mm_set1_pd(-0.), a.v)}; }
+
+  static SSE2D CmpEq(SSE2D a, SSE2D b) { return {_mm_cmpeq_pd(a.v, b.v)}; }
+  static SSE2D CmpLt(SSE2D a, SSE2D b) { return {_mm_cmplt_pd(a.v, b.v)}; }
+  static SSE2D CmpLe(SSE2D a, SSE2D b) { return {_mm_cmple_pd(a.v, b.v)}; }
+  static SSE2D CmpGt(SSE2D a, SSE2D b) { return {_mm_cmpgt_pd(a.v, b.v)}; }
+  static SSE2D Select(SSE2D mask, SSE2D a, SSE2D b) { return {_mm_or_pd(_mm_and_pd(mask.v, a.v), _mm_andnot_pd(mask.v, b.v))}; }
+  static bool AllTrue(SSE2D mask) { return _mm_movemask_pd(mask.v) == 0x3; }
+  static bool AnyTrue(SSE2D mask) { return _mm_movemask_pd(mask.v) != 0; }
+
+  static SSE2D Round(SSE2D a)
+  {
+    const __m128d magic = _mm_set1_pd(6755399441055744.); // 1.5 * 2^52
+    return {_mm_sub_pd(_mm_add_pd(a.v, magic), magic)};
+  }
+  static SSE2D Ldexp2(SSE2D n)
+  {
+    // The low mantissa bits of (2^52 + k) hold k, shifting them up lands k in the exponent field
+    const __m128i biased = _mm_castpd_si128(_mm_add_pd(n.v, _mm_set1_pd(4503599627370496. + 1023.)));
+    return {_mm_castsi128_pd(_mm_slli_epi64(biased, 52))};
+  }
+  static SSE2D Exponent(SSE2D a)
+  {
+    const __m128i field = _mm_srli_epi64(_mm_castpd_si128(a.v), 52);
+    const __m128d two52 = _mm_set1_pd(4503599627370496.);
+    const __m128d e = _mm_sub_pd(_mm_or_pd(_mm_castsi128_pd(field), two52), two52);
+    return {_mm_sub_pd(e, _mm_set1_pd(1023.))};
+  }
+  static SSE2D Mantissa(SSE2D a)
+  {
+    const __m128i bits = _mm_and_si128(_mm_castpd_si128(a.v), _mm_set1_epi64x(0x000fffffffffffffLL));
+    return {_mm_castsi128_pd(_mm_or_si128(bits, _mm_set1_epi64x(0x3ff0000000000000LL)))};
+  }
+};
+
+struct AVX2D
+{
+  using Scalar = double;
+  static constexpr int kSize = 4;
+  __m256d v;
+
+  SIMD_TARGET_AVX2 static AVX2D Load(const double* p) { return {_mm256_loadu_pd(p)}; }
+  SIMD_TARGET_AVX2 void Store(double* p) const { _mm256_storeu_pd(p, v); }
+  SIMD_TARGET_AVX2 static AVX2D Set(double s) { return {_mm256_set1_pd(s)}; }
+
+  SIMD_TARGET_AVX2 friend AVX2D operator+(AVX2D a, AVX2D b) { return {_mm256_add_pd(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 friend AVX2D operator-(AVX2D a, AVX2D b) { return {_mm256_sub_pd(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 friend AVX2D operator*(AVX2D a, AVX2D b) { return {_mm256_mul_pd(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 friend AVX2D operator/(AVX2D a, AVX2D b) { return {_mm256_div_pd(a.v, b.v)}; }
+
+  SIMD_TARGET_AVX2 static AVX2D MulAdd(AVX2D a, AVX2D b, AVX2D c) { return {_mm256_fmadd_pd(a.v, b.v, c.v)}; }
+  SIMD_TARGET_AVX2 static AVX2D Min(AVX2D a, AVX2D b) { return {_mm256_min_pd(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 static AVX2D Max(AVX2D a, AVX2D b) { return {_mm256_max_pd(a.v, b.v)}; }
+
+  SIMD_TARGET_AVX2 static AVX2D And(AVX2D a, AVX2D b) { return {_mm256_and_pd(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 static AVX2D Or(AVX2D a, AVX2D b) { return {_mm256_or_pd(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 static AVX2D Xor(AVX2D a, AVX2D b) { return {_mm256_xor_pd(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 static AVX2D AndNot(AVX2D a, AVX2D b) { return {_mm256_andnot_pd(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 static AVX2D Abs(AVX2D a) { return {_mm256_andnot_pd(_mm256_set1_pd(-0.), a.v)}; }
+  SIMD_TARGET_AVX2 static AVX2D SignBit(AVX2D a) { return {_mm256_and_pd(_mm256_set1_pd(-0.), a.v)}; }
+
+  SIMD_TARGET_AVX2 static AVX2D CmpEq(AVX2D a, AVX2D b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ)}; }
+  SIMD_TARGET_AVX2 static AVX2D CmpLt(AVX2D a, AVX2D b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ)}; }
+  SIMD_TARGET_AVX2 static AVX2D CmpLe(AVX2D a, AVX2D b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ)}; }
+  SIMD_TARGET_AVX2 static AVX2D CmpGt(AVX2D a, AVX2D b) { return {_mm256_cmp_pd(a.v, b.v, _CMP_GT_OQ)}; }
+  SIMD_TARGET_AVX2 static AVX2D Select(AVX2D mask, AVX2D a, AVX2D b) { return {_mm256_blendv_pd(b.v, a.v, mask.v)}; }
+  SIMD_TARGET_AVX2 static bool AllTrue(AVX2D mask) { return _mm256_movemask_pd(mask.v) == 0xf; }
+  SIMD_TARGET_AVX2 static bool AnyTrue(AVX2D mask) { return _mm256_movemask_pd(mask.v) != 0; }
+
+  SIMD_TARGET_AVX2 static AVX2D Round(AVX2D a) { return {_mm256_round_pd(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+  SIMD_TARGET_AVX2 static AVX2D Ldexp2(AVX2D n)
+  {
+    const __m256i biased = _mm256_castpd_si256(_mm256_add_pd(n.v, _mm256_set1_pd(4503599627370496. + 1023.)));
+    return {_mm256_castsi256_pd(_mm256_slli_epi64(biased, 52))};
+  }
+  SIMD_TARGET_AVX2 static AVX2D Exponent(AVX2D a)
+  {
+    const __m256i field = _mm256_srli_epi64(_mm256_castpd_si256(a.v), 52);
+    const __m256d two52 = _mm256_set1_pd(4503599627370496.);
+    const __m256d e = _mm256_sub_pd(_mm256_or_pd(_mm256_castsi256_pd(field), two52), two52);
+    return {_mm256_sub_pd(e, _mm256_set1_pd(1023.))};
+  }
+  SIMD_TARGET_AVX2 static AVX2D Mantissa(AVX2D a)
+  {
+    const __m256i bits = _mm256_and_si256(_mm256_castpd_si256(a.v), _mm256_set1_epi64x(0x000fffffffffffffLL));
+    return {_mm256_castsi256_pd(_mm256_or_si256(bits, _mm256_set1_epi64x(0x3ff0000000000000LL)))};
+  }
+};
+struct SSE2F
+{
+  using Scalar = float;
+  static constexpr int kSize = 4;
+  __m128 v;
+
+  static SSE2F Load(const float* p) { return {_mm_loadu_ps(p)}; }
+  void Store(float* p) const { _mm_storeu_ps(p, v); }
+  static SSE2F Set(float s) { return {_mm_set1_ps(s)}; }
+
+  friend SSE2F operator+(SSE2F a, SSE2F b) { return {_mm_add_ps(a.v, b.v)}; }
+  friend SSE2F operator-(SSE2F a, SSE2F b) { return {_mm_sub_ps(a.v, b.v)}; }
+  friend SSE2F operator*(SSE2F a, SSE2F b) { return {_mm_mul_ps(a.v, b.v)}; }
+  friend SSE2F operator/(SSE2F a, SSE2F b) { return {_mm_div_ps(a.v, b.v)}; }
+
+  static SSE2F MulAdd(SSE2F a, SSE2F b, SSE2F c) { return {_mm_add_ps(_mm_mul_ps(a.v, b.v), c.v)}; }
+  static SSE2F Min(SSE2F a, SSE2F b) { return {_mm_min_ps(a.v, b.v)}; }
+  static SSE2F Max(SSE2F a, SSE2F b) { return {_mm_max_ps(a.v, b.v)}; }
+
+  static SSE2F And(SSE2F a, SSE2F b) { return {_mm_and_ps(a.v, b.v)}; }
+  static SSE2F Or(SSE2F a, SSE2F b) { return {_mm_or_ps(a.v, b.v)}; }
+  static SSE2F Xor(SSE2F a, SSE2F b) { return {_mm_xor_ps(a.v, b.v)}; }
+  static SSE2F AndNot(SSE2F a, SSE2F b) { return {_mm_andnot_ps(a.v, b.v)}; }
+  static SSE2F Abs(SSE2F a) { return {_mm_andnot_ps(_mm_set1_ps(-0.f), a.v)}; }
+  static SSE2F SignBit(SSE2F a) { return {_mm_and_ps(_mm_set1_ps(-0.f), a.v)}; }
+
+  static SSE2F CmpEq(SSE2F a, SSE2F b) { return {_mm_cmpeq_ps(a.v, b.v)}; }
+  static SSE2F CmpLt(SSE2F a, SSE2F b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+  static SSE2F CmpLe(SSE2F a, SSE2F b) { return {_mm_cmple_ps(a.v, b.v)}; }
+  static SSE2F CmpGt(SSE2F a, SSE2F b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+  static SSE2F Select(SSE2F mask, SSE2F a, SSE2F b) { return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))}; }
+  static bool AllTrue(SSE2F mask) { return _mm_movemask_ps(mask.v) == 0xf; }
+  static bool AnyTrue(SSE2F mask) { return _mm_movemask_ps(mask.v) != 0; }
+
+  static SSE2F Round(SSE2F a)
+  {
+    const __m128 magic = _mm_set1_ps(12582912.f); // 1.5 * 2^23
+    return {_mm_sub_ps(_mm_add_ps(a.v, magic), magic)};
+  }
+  static SSE2F Ldexp2(SSE2F n)
+  {
+    const __m128i biased = _mm_castps_si128(_mm_add_ps(n.v, _mm_set1_ps(8388608.f + 127.f)));
+    return {_mm_castsi128_ps(_mm_slli_epi32(biased, 23))};
+  }
+  static SSE2F Exponent(SSE2F a)
+  {
+    const __m128i field = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(a.v), 23), _mm_set1_epi32(0xff));
+    return {_mm_sub_ps(_mm_cvtepi32_ps(field), _mm_set1_ps(127.f))};
+  }
+  static SSE2F Mantissa(SSE2F a)
+  {
+    const __m128i bits = _mm_and_si128(_mm_castps_si128(a.v), _mm_set1_epi32(0x007fffff));
+    return {_mm_castsi128_ps(_mm_or_si128(bits, _mm_set1_epi32(0x3f800000)))};
+  }
+};
+
+struct AVX2F
+{
+  using Scalar = float;
+  static constexpr int kSize = 8;
+  __m256 v;
+
+  SIMD_TARGET_AVX2 static AVX2F Load(const float* p) { return {_mm256_loadu_ps(p)}; }
+  SIMD_TARGET_AVX2 void Store(float* p) const { _mm256_storeu_ps(p, v); }
+  SIMD_TARGET_AVX2 static AVX2F Set(float s) { return {_mm256_set1_ps(s)}; }
+
+  SIMD_TARGET_AVX2 friend AVX2F operator+(AVX2F a, AVX2F b) { return {_mm256_add_ps(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 friend AVX2F operator-(AVX2F a, AVX2F b) { return {_mm256_sub_ps(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 friend AVX2F operator*(AVX2F a, AVX2F b) { return {_mm256_mul_ps(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 friend AVX2F operator/(AVX2F a, AVX2F b) { return {_mm256_div_ps(a.v, b.v)}; }
+
+  SIMD_TARGET_AVX2 static AVX2F MulAdd(AVX2F a, AVX2F b, AVX2F c) { return {_mm256_fmadd_ps(a.v, b.v, c.v)}; }
+  SIMD_TARGET_AVX2 static AVX2F Min(AVX2F a, AVX2F b) { return {_mm256_min_ps(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 static AVX2F Max(AVX2F a, AVX2F b) { return {_mm256_max_ps(a.v, b.v)}; }
+
+  SIMD_TARGET_AVX2 static AVX2F And(AVX2F a, AVX2F b) { return {_mm256_and_ps(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 static AVX2F Or(AVX2F a, AVX2F b) { return {_mm256_or_ps(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 static AVX2F Xor(AVX2F a, AVX2F b) { return {_mm256_xor_ps(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 static AVX2F AndNot(AVX2F a, AVX2F b) { return {_mm256_andnot_ps(a.v, b.v)}; }
+  SIMD_TARGET_AVX2 static AVX2F Abs(AVX2F a) { return {_mm256_andnot_ps(_mm256_set1_ps(-0.f), a.v)}; }
+  SIMD_TARGET_AVX2 static AVX2F SignBit(AVX2F a) { return {_mm256_and_ps(_mm256_set1_ps(-0.f), a.v)}; }
+
+  SIMD_TARGET_AVX2 static AVX2F CmpEq(AVX2F a, AVX2F b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_EQ_OQ)}; }
+  SIMD_TARGET_AVX2 static AVX2F CmpLt(AVX2F a, AVX2F b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+  SIMD_TARGET_AVX2 static AVX2F CmpLe(AVX2F a, AVX2F b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ)}; }
+  SIMD_TARGET_AVX2 static AVX2F CmpGt(AVX2F a, AVX2F b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+  SIMD_TARGET_AVX2 static AVX2F Select(AVX2F mask, AVX2F a, AVX2F b) { return {_mm256_blendv_ps(b.v, a.v, mask.v)}; }
+  SIMD_TARGET_AVX2 static bool AllTrue(AVX2F mask) { return _mm256_movemask_ps(mask.v) == 0xff; }
+  SIMD_TARGET_AVX2 static bool AnyTrue(AVX2F mask) { return _mm256_movemask_ps(mask.v) != 0; }
+
+  SIMD_TARGET_AVX2 static AVX2F Round(AVX2F a) { return {_mm256_round_ps(a.v, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)}; }
+  SIMD_TARGET_AVX2 static AVX2F Ldexp2(AVX2F n)
+  {
+    const __m256i biased = _mm256_castps_si256(_mm256_add_ps(n.v, _mm256_set1_ps(8388608.f + 127.f)));
+    return {_mm256_castsi256_ps(_mm256_slli_epi32(biased, 23))};
+  }
+  SIMD_TARGET_AVX2 static AVX2F Exponent(AVX2F a)
+  {
+    const __m256i field = _mm256_and_si256(_mm256_srli_epi32(_mm256_castps_si256(a.v), 23), _mm256_set1_epi32(0xff));
+    return {_mm256_sub_ps(_mm256_cvtepi32_ps(field), _mm256_set1_ps(127.f))};
+  }
+  SIMD_TARGET_AVX2 static AVX2F Mantissa(AVX2F a)
+  {
+    const __m256i bits = _mm256_and_si256(_mm256_castps_si256(a.v), _mm256_set1_epi32(0x007fffff));
+    return {_mm256_castsi256_ps(_mm256_or_si256(bits, _mm256_set1_epi32(0x3f800000)))};
+  }
+};
+#endif
+
+#if defined SIMD_NEON
+struct NEOND
+{
+  using Scalar = double;
+  static constexpr int kSize = 2;
+  float64x2_t v;
+
+  static NEOND Load(const double* p) { return {vld1q_f64(p)}; }
+  void Store(double* p) const { vst1q_f64(p, v); }
+  static NEOND Set(double s) { return {vdupq_n_f64(s)}; }
+
+  friend NEOND operator+(NEOND a, NEOND b) { return {vaddq_f64(a.v, b.v)}; }
+  friend NEOND operator-(NEOND a, NEOND b) { return {vsubq_f64(a.v, b.v)}; }
+  friend NEOND operator*(NEOND a, NEOND b) { return {vmulq_f64(a.v, b.v)}; }
+  friend NEOND operator/(NEOND a, NEOND b) { return {vdivq_f64(a.v, b.v)}; }
+
+  static NEOND MulAdd(NEOND a, NEOND b, NEOND c) { return {vfmaq_f64(c.v, a.v, b.v)}; }
+  static NEOND Min(NEOND a, NEOND b) { return {vminq_f64(a.v, b.v)}; }
+  static NEOND Max(NEOND a, NEOND b) { return {vmaxq_f64(a.v, b.v)}; }
+
+  static NEOND And(NEOND a, NEOND b) { return FromBits(vandq_u64(Bits(a), Bits(b))); }
+  static NEOND Or(NEOND a, NEOND b) { return FromBits(vorrq_u64(Bits(a), Bits(b))); }
+  static NEOND Xor(NEOND a, NEOND b) { return FromBits(veorq_u64(Bits(a), Bits(b))); }
+  static NEOND AndNot(NEOND a, NEOND b) { return FromBits(vbicq_u64(Bits(b), Bits(a))); }
+  static NEOND Abs(NEOND a) { return {vabsq_f64(a.v)}; }
+  static NEOND SignBit(NEOND a) { return FromBits(vandq_u64(Bits(a), vdupq_n_u64(0x8000000000000000ULL))); }
+
+  static NEOND CmpEq(NEOND a, NEOND b) { return FromBits(vceqq_f64(a.v, b.v)); }
+  static NEOND CmpLt(NEOND a, NEOND b) { return FromBits(vcltq_f64(a.v, b.v)); }
+  static NEOND CmpLe(NEOND a, NEOND b) { return FromBits(vcleq_f64(a.v, b.v)); }
+  static NEOND CmpGt(NEOND a, NEOND b) { return FromBits(vcgtq_f64(a.v, b.v)); }
+  static NEOND Select(NEOND mask, NEOND a, NEOND b) { return {vbslq_f64(Bits(mask), a.v, b.v)}; }
+  static bool AllTrue(NEOND mask) { return (vgetq_lane_u64(Bits(mask), 0) & vgetq_lane_u64(Bits(mask), 1)) != 0; }
+  static bool AnyTrue(NEOND mask) { return (vgetq_lane_u64(Bits(mask), 0) | vgetq_lane_u64(Bits(mask), 1)) != 0; }
+
+  static NEOND Round(NEOND a) { return {vrndnq_f64(a.v)}; }
+  static NEOND Ldexp2(NEOND n)
+  {
+    const int64x2_t biased = vaddq_s64(vcvtq_s64_f64(n.v), vdupq_n_s64(1023));
+    return {vreinterpretq_f64_s64(vshlq_n_s64(biased, 52))};
+  }
+  static NEOND Exponent(NEOND a)
+  {
+    const uint64x2_t field = vshrq_n_u64(Bits(a), 52);
+    return {vsubq_f64(vcvtq_f64_u64(field), vdupq_n_f64(1023.))};
+  }
+  static NEOND Mantissa(NEOND a)
+  {
+    const uint64x2_t bits = vandq_u64(Bits(a), vdupq_n_u64(0x000fffffffffffffULL));
+    return FromBits(vorrq_u64(bits, vdupq_n_u64(0x3ff0000000000000ULL)));
+  }
+
+private:
+  static uint64x2_t Bits(NEOND a) { return vreinterpretq_u64_f64(a.v); }
+  static NEOND FromBits(uint64x2_t b) { return {vreinterpretq_f64_u64(b)}; }
+};
+
+struct NEONF
+{
+  using Scalar = float;
+  static constexpr int kSize = 4;
+  float32x4_t v;
+
+  static NEONF Load(const float* p) { return {vld1q_f32(p)}; }
+  void Store(float* p) const { vst1q_f32(p, v); }
+  static NEONF Set(float s) { return {vdupq_n_f32(s)}; }
+
+  friend NEONF operator+(NEONF a, NEONF b) { return {vaddq_f32(a.v, b.v)}; }
+  friend NEONF operator-(NEONF a, NEONF b) { return {vsubq_f32(a.v, b.v)}; }
+  friend NEONF operator*(NEONF a, NEONF b) { return {vmulq_f32(a.v, b.v)}; }
+  friend NEONF operator/(NEONF a, NEONF b) { return {vdivq_f32(a.v, b.v)}; }
+
+  static NEONF MulAdd(NEONF a, NEONF b, NEONF c) { return {vfmaq_f32(c.v, a.v, b.v)}; }
+  static NEONF Min(NEONF a, NEONF b) { return {vminq_f32(a.v, b.v)}; }
+  static NEONF Max(NEONF a, NEONF b) { return {vmaxq_f32(a.v, b.v)}; }
+
+  static NEONF And(NEONF a, NEONF b) { return FromBits(vandq_u32(Bits(a), Bits(b))); }
+  static NEONF Or(NEONF a, NEONF b) { return FromBits(vorrq_u32(Bits(a), Bits(b))); }
+  static NEONF Xor(NEONF a, NEONF b) { return FromBits(veorq_u32(Bits(a), Bits(b))); }
+  static NEONF AndNot(NEONF a, NEONF b) { return FromBits(vbicq_u32(Bits(b), Bits(a))); }
+  static NEONF Abs(NEONF a) { return {vabsq_f32(a.v)}; }
+  static NEONF SignBit(NEONF a) { return FromBits(vandq_u32(Bits(a), vdupq_n_u32(0x80000000U))); }
+
+  static NEONF CmpEq(NEONF a, NEONF b) { return FromBits(vceqq_f32(a.v, b.v)); }
+  static NEONF CmpLt(NEONF a, NEONF b) { return FromBits(vcltq_f32(a.v, b.v)); }
+  static NEONF CmpLe(NEONF a, NEONF b) { return FromBits(vcleq_f32(a.v, b.v)); }
+  static NEONF CmpGt(NEONF a, NEONF b) { return FromBits(vcgtq_f32(a.v, b.v)); }
+  static NEONF Select(NEONF mask, NEONF a, NEONF b) { return {vbslq_f32(Bits(mask), a.v, b.v)}; }
+  static bool AllTrue(NEONF mask) { return vminvq_u32(Bits(mask)) != 0; }
+  static bool AnyTrue(NEONF mask) { return vmaxvq_u32(Bits(mask)) != 0; }
+
+  static NEONF Round(NEONF a) { return {vrndnq_f32(a.v)}; }
+  static NEONF Ldexp2(NEONF n)
+  {
+    const int32x4_t biased = vaddq_s32(vcvtq_s32_f32(n.v), vdupq_n_s32(127));
+    return {vreinterpretq_f32_s32(vshlq_n_s32(biased, 23))};
+  }
+  static NEONF Exponent(NEONF a)
+  {
+    const uint32x4_t field = vandq_u32(vshrq_n_u32(Bits(a), 23), vdupq_n_u32(0xff));
+    return {vsubq_f32(vcvtq_f32_u32(field), vdupq_n_f32(127.f))};
+  }
+  static NEONF Mantissa(NEONF a)
+  {
+    const uint32x4_t bits = vandq_u32(Bits(a), vdupq_n_u32(0x007fffffU));
+    return FromBits(vorrq_u32(bits, vdupq_n_u32(0x3f800000U)));
+  }
+
+private:
+  static uint32x4_t Bits(NEONF a) { return vreinterpretq_u32_f32(a.v); }
+  static NEONF FromBits(uint32x4_t b) { return {vreinterpretq_f32_u32(b)}; }
+};
+#endif
+
+/** The vector types for the sample type T, double or float */
+template <typename T>
+struct VectorTypes;
+
+template <>
+struct VectorTypes<double>
+{
+  using Scalar = ScalarD;
+#if defined SIMD_X86
+  using SSE2 = SSE2D;
+  using AVX2 = AVX2D;
+#elif defined SIMD_NEON
+  using NEON = NEOND;
+#endif
+};
+
+template <>
+struct VectorTypes<float>
+{
+  using Scalar = ScalarF;
+#if defined SIMD_X86
+  using SSE2 = SSE2F;
+  using AVX2 = AVX2F;
+#elif defined SIMD_NEON
+  using NEON = NEONF;
+#endif
+};
+} // namespace simd
+END_IPLUG_NAMESPACE
@@ -0,0 +1,225 @@
+#pragma once
+
+#include <type_traits>
+
+#include "SIMD.h"
+
+BEGIN_IPLUG_NAMESPACE
+namespace simd
+{
+/** The float vectors get their own shorter polynomials and reduction constants, the double ones would only add work below the float epsilon */
+template <typename V>
+constexpr bool IsSinglePrecision()
+{
+  return std::is_same<typename V::Scalar, float>::value;
+}
+
+// quadrant mod 4 picks sin/cos and the sign of the result
+template <typename V>
+inline V SelectQuadrant(V quadrant, V s, V c)
+{
+  V q = quadrant * V::Set(.25);
+  V qFloor = V::Round(q);
+  qFloor = qFloor - V::And(V::CmpGt(qFloor, q), V::Set(1.));
+  q = quadrant - qFloor * V::Set(4.);
+  const V useCos = V::Or(V::CmpEq(q, V::Set(1.)), V::CmpEq(q, V::Set(3.)));
+  const V negate = V::CmpGt(q, V::Set(1.5));
+  const V result = V::Select(useCos, c, s);
+  return V::Xor(result, V::And(negate, V::Set(-0.)));
+}
+
+/** Vectorised sine. Cody-Waite reduction to [-PI/4, PI/4] followed by the fdlibm kernel polynomials.
+ * Absolute error stays below 1e-15 for |x| < 2^20, which covers every argument the waveshaper produces.
+ * Float vectors use the cephes sinf/cosf kernels, absolute error below 1e-6 for |x| < 2^13. */
+template <typename V>
+inline V Sin(V x)
+{
+  const V quadrant = V::Round(x * V::Set(0.63661977236758134308)); // 2/PI
+  if constexpr (IsSinglePrecision<V>())
+  {
+    // The first part of PI/2 has 8 significant bits, its products with the quadrant are exact
+    V r = x - quadrant * V::Set(1.5703125f);
+    r = r - quadrant * V::Set(4.837512969970703125e-4f);
+    r = r - quadrant * V::Set(7.54978995489188216e-8f);
+    const V z = r * r;
+
+    V sinPoly = V::MulAdd(z, V::Set(-1.9515295891e-4f), V::Set(8.3321608736e-3f));
+    sinPoly = V::MulAdd(z, sinPoly, V::Set(-1.6666654611e-1f));
+    const V s = V::MulAdd(z * r, sinPoly, r);
+
+    V cosPoly = V::MulAdd(z, V::Set(2.443315711809948e-5f), V::Set(-1.388731625493765e-3f));
+    cosPoly = V::MulAdd(z, cosPoly, V::Set(4.166664568298827e-2f));
+    const V c = V::MulAdd(z * z, cosPoly, V::Set(1.f) - V::Set(.5f) * z);
+    return SelectQuadrant(quadrant, s, c);
+  }
+  else
+  {
+    V r = x - quadrant * V::Set(1.57079632673412561417e+00);
+    r = r - quadrant * V::Set(6.07710050630396597660e-11);
+    r = r - quadrant * V::Set(2.02226624871116645580e-21);
+    const V z = r * r;
+
+    V sinPoly = V::MulAdd(z, V::Set(1.58969099521155010221e-10), V::Set(-2.50507602534068634195e-08));
+    sinPoly = V::MulAdd(z, sinPoly, V::Set(2.75573137070700676789e-06));
+    sinPoly = V::MulAdd(z, sinPoly, V::Set(-1.98412698298579493134e-04));
+    sinPoly = V::MulAdd(z, sinPoly, V::Set(8.33333333332248946124e-03));
+    sinPoly = V::MulAdd(z, sinPoly, V::Set(-1.66666666666666324348e-01));
+    const V s = V::MulAdd(z * r, sinPoly, r);
+
+    V cosPoly = V::MulAdd(z, V::Set(-1.13596475577881948265e-11), V::Set(2.08757232129817482790e-09));
+    cosPoly = V::MulAdd(z, cosPoly, V::Set(-2.75573143513906633035e-07));
+    cosPoly = V::MulAdd(z, cosPoly, V::Set(2.48015872894767294178e-05));
+    cosPoly = V::MulAdd(z, cosPoly, V::Set(-1.38888888888741095749e-03));
+    cosPoly = V::MulAdd(z, cosPoly, V::Set(4.16666666666666019037e-02));
+    const V c = V::MulAdd(z * z, cosPoly, V::Set(1.) - V::Set(.5) * z);
+    return SelectQuadrant(quadrant, s, c);
+  }
+}
+
+/** Vectorised log2 for x > 0 (normal range), error below 2e-16 relative (float: 1e-7) */
+template <typename V>
+inline V Log2(V x)
+{
+  V m = V::Mantissa(x);
+  V exponent = V::Exponent(x);
+  const V big = V::CmpGt(m, V::Set(1.41421356237309504880));
+  m = V::Select(big, m * V::Set(.5), m);
+  exponent = exponent + V::And(big, V::Set(1.));
+
+  // ln(m) = 2 atanh(f), |f| <= 0.1716
+  const V f = (m - V::Set(1.)) / (m + V::Set(1.));
+  const V f2 = f * f;
+  V poly;
+  if constexpr (IsSinglePrecision<V>())
+  {
+    poly = V::MulAdd(f2, V::Set(1.f / 9.f), V::Set(1.f / 7.f));
+  }
+  else
+  {
+    poly = V::MulAdd(f2, V::Set(1. / 19.), V::Set(1. / 17.));
+    poly = V::MulAdd(f2, poly, V::Set(1. / 15.));
+    poly = V::MulAdd(f2, poly, V::Set(1. / 13.));
+    poly = V::MulAdd(f2, poly, V::Set(1. / 11.));
+    poly = V::MulAdd(f2, poly, V::Set(1. / 9.));
+    poly = V::MulAdd(f2, poly, V::Set(1. / 7.));
+  }
+  poly = V::MulAdd(f2, poly, V::Set(1. / 5.));
+  poly = V::MulAdd(f2, poly, V::Set(1. / 3.));
+  const V lnM = V::Set(2.) * V::MulAdd(f2 * f, poly, f);
+  return V::MulAdd(lnM, V::Set(1.44269504088896340736), exponent); // 1/ln(2)
+}
+
+/** Vectorised 2^x, error below 2e-16 relative (float: 2e-7). Results that would be subnormal are flushed to zero. */
+template <typename V>
+inline V Exp2(V x)
+{
+  constexpr double minExponent = IsSinglePrecision<V>() ? -126. : -1022.;
+  constexpr double maxExponent = IsSinglePrecision<V>() ? 127. : 1023.;
+  const V underflow = V::CmpLt(x, V::Set(minExponent));
+  x = V::Min(V::Max(x, V::Set(minExponent)), V::Set(maxExponent));
+  const V n = V::Round(x);
+  const V g = (x - n) * V::Set(0.69314718055994530942); // ln(2)
+
+  V poly;
+  if constexpr (IsSinglePrecision<V>())
+  {
+    poly = V::MulAdd(g, V::Set(1.f / 5040.f), V::Set(1.f / 720.f));
+  }
+  else
+  {
+    poly = V::MulAdd(g, V::Set(1. / 6227020800.), V::Set(1. / 479001600.));
+    poly = V::MulAdd(g, poly, V::Set(1. / 39916800.));
+    poly = V::MulAdd(g, poly, V::Set(1. / 3628800.));
+    poly = V::MulAdd(g, poly, V::Set(1. / 362880.));
+    poly = V::MulAdd(g, poly, V::Set(1. / 40320.));
+    poly = V::MulAdd(g, poly, V::Set(1. / 5040.));
+    poly = V::MulAdd(g, poly, V::Set(1. / 720.));
+  }
+  poly = V::MulAdd(g, poly, V::Set(1. / 120.));
+  poly = V::MulAdd(g, poly, V::Set(1. / 24.));
+  poly = V::MulAdd(g, poly, V::Set(1. / 6.));
+  poly = V::MulAdd(g, poly, V::Set(.5));
+  poly = V::MulAdd(g, poly, V::Set(1.));
+  poly = V::MulAdd(g, poly, V::Set(1.));
+  return V::AndNot(underflow, poly * V::Ldexp2(n));
+}
+
+/** Vectorised pow for a non-negative base, pow(0, y) = 0 for the positive exponents used here */
+template <typename V>
+inline V Pow(V x, V y)
+{
+  const V isZero = V::CmpLe(x, V::Set(0.));
+  return V::AndNot(isZero, Exp2(y * Log2(x)));
+}
+
+// Cheaper variants for realtime use: minimax polynomials fitted to the domains of the waveshaper, sine arguments up to 16 PI (Sync 16 at |x| = 1)
+// and bases in [0, 1] for pow. The same polynomials serve float and double vectors, about float accuracy in both.
+
+/** Sine by half periods, a degree 7 odd polynomial on [-PI/2, PI/2]. Relative error below 9.4e-7 (float: 1.1e-6 absolute) for |x| < 2^15. */
+template <typename V>
+inline V SinFast(V x)
+{
+  const V k = V::Round(x * V::Set(0.31830988618379067154)); // 1/PI
+  // The first part of PI has 8 significant bits, its products with k are exact in float as well
+  V r = x - k * V::Set(3.140625);
+  r = r - k * V::Set(9.67653589793115997963e-4);
+  const V z = r * r;
+
+  V poly = V::MulAdd(z, V::Set(-1.848814028862405e-4), V::Set(8.3118998013949966e-3));
+  poly = V::MulAdd(z, poly, V::Set(-1.6665554092758902e-1));
+  poly = V::MulAdd(z, poly, V::Set(9.999990608989795e-1));
+
+  // Odd half periods flip the sign
+  const V half = k * V::Set(.5);
+  const V odd = V::AndNot(V::CmpEq(V::Round(half), half), V::Set(-0.));
+  return V::Xor(r * poly, odd);
+}
+
+/** log2 for x > 0 (normal range) with a degree 7 polynomial of the mantissa and no division, absolute error below 4.4e-7 (float: 1e-6) */
+template <typename V>
+inline V Log2Fast(V x)
+{
+  V m = V::Mantissa(x);
+  V exponent = V::Exponent(x);
+  const V big = V::CmpGt(m, V::Set(1.41421356237309504880));
+  m = V::Select(big, m * V::Set(.5), m);
+  exponent = exponent + V::And(big, V::Set(1.));
+
+  const V f = m - V::Set(1.);
+  V poly = V::MulAdd(f, V::Set(1.4452061816515813e-1), V::Set(-2.655921408041349e-1));
+  poly = V::MulAdd(f, poly, V::Set(3.0207440397244517e-1));
+  poly = V::MulAdd(f, poly, V::Set(-3.5986963731315735e-1));
+  poly = V::MulAdd(f, poly, V::Set(4.8018141068166975e-1));
+  poly = V::MulAdd(f, poly, V::Set(-7.2135105271442201e-1));
+  poly = V::MulAdd(f, poly, V::Set(1.4427044471993173));
+  return V::MulAdd(f, poly, exponent);
+}
+
+/** 2^x with a degree 5 polynomial on [-0.5, 0.5], relative error below 7.5e-8 (float: 2.5e-7). Results that would be subnormal are flushed to zero. */
+template <typename V>
+inline V Exp2Fast(V x)
+{
+  constexpr double minExponent = IsSinglePrecision<V>() ? -126. : -1022.;
+  constexpr double maxExponent = IsSinglePrecision<V>() ? 127. : 1023.;
+  const V underflow = V::CmpLt(x, V::Set(minExponent));
+  x = V::Min(V::Max(x, V::Set(minExponent)), V::Set(maxExponent));
+  const V n = V::Round(x);
+  const V g = x - n;
+
+  V poly = V::MulAdd(g, V::Set(1.3276471979286704e-3), V::Set(9.675541334209831e-3));
+  poly = V::MulAdd(g, poly, V::Set(5.5507132735430752e-2));
+  poly = V::MulAdd(g, poly, V::Set(2.4022119723848651e-1));
+  poly = V::MulAdd(g, poly, V::Set(6.93146967064733e-1));
+  poly = V::MulAdd(g, poly, V::Set(1.0000000716546822));
+  return V::AndNot(underflow, poly * V::Ldexp2(n));
+}
+
+/** pow for a non-negative base from Log2Fast() and Exp2Fast(). The relative error grows with the exponent, below 3.1e-7 * |y| + 7.5e-8 (float: 1e-6 * |y| + 2.5e-7). */
+template <typename V>
+inline V PowFast(V x, V y)
+{
+  const V isZero = V::CmpLe(x, V::Set(0.));
+  return V::AndNot(isZero, Exp2Fast(y * Log2Fast(x)));
+}
+} // namespace simd
+END_IPLUG_NAMESPACE
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+/** Wait-free ring buffer for one producer and one consumer thread. The capacity is rounded up to a power of two and fixed at construction,
+ * Write() and Read() never allocate, lock or wait: a full ring drops what doesn't fit and an empty one reads nothing.
+ * Write() belongs to the producer, Read(), GetReadable() and Discard() to the consumer. */
+template <typename T>
+class SPSCRing
+{
+public:
+  explicit SPSCRing(int capacity)
+  {
+    size_t size = 1;
+    while (size < static_cast<size_t>(std::max(capacity, 1)))
+      size *= 2;
+    mBuffer.resize(size);
+    mMask = size - 1;
+  }
+
+  SPSCRing(const SPSCRing&) = delete;
+  SPSCRing& operator=(const SPSCRing&) = delete;
+
+  int GetCapacity() const { return static_cast<int>(mBuffer.size()); }
+
+  /** Appends up to n items, returns how many fit */
+  int Write(const T* items, int n)
+  {
+    const size_t write = mWrite.load(std::memory_order_relaxed);
+    const size_t read = mRead.load(std::memory_order_acquire);
+    const size_t count = std::min(static_cast<size_t>(std::max(n, 0)), mBuffer.size() - (write - read));
+    for (size_t i = 0; i < count; i++)
+      mBuffer[(write + i) & mMask] = items[i];
+    mWrite.store(write + count, std::memory_order_release);
+    return static_cast<int>(count);
+  }
+
+  int GetReadable() const { return static_cast<int>(mWrite.load(std::memory_order_acquire) - mRead.load(std::memory_order_relaxed)); }
+
+  /** Takes up to n of the oldest items, returns how many */
+  int Read(T* items, int n)
+  {
+    const size_t read = mRead.load(std::memory_order_relaxed);
+    const size_t write = mWrite.load(std::memory_order_acquire);
+    const size_t count = std::min(static_cast<size_t>(std::max(n, 0)), write - read);
+    for (size_t i = 0; i < count; i++)
+      items[i] = mBuffer[(read + i) & mMask];
+    mRead.store(read + count, std::memory_order_release);
+    return static_cast<int>(count);
+  }
+
+  /** Drops everything written so far */
+  void Discard() { mRead.store(mWrite.load(std::memory_order_acquire), std::memory_order_release); }
+
+private:
+  std::vector<T> mBuffer;
+  size_t mMask = 0;
+  // On separate cache lines, each is written by one side only
+  alignas(64) std::atomic<size_t> mWrite{0};
+  alignas(64) std::atomic<size_t> mRead{0};
+};
@@ -1,16 +1,24 @@
 #pragma once
 
-#include "IPlug_include_in_plug_hdr.h"
+#include "IPlugConstants.h"
+#include "IPlugUtilities.h"
+#include "SIMDMath.h"
+#include "SineWaveshaperAlgorithms.h"
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <tuple>
+#include <type_traits>
+#include <utility>
 
 const double e = std::exp(1.);
-iplug::sample sign(iplug::sample sample) { return signbit(sample) ? -1. : 1.; }
-iplug::sample clip(iplug::sample sample) { return sign(sample) * std::min(std::abs(sample), 1.); }
+inline iplug::sample sign(iplug::sample sample) { return std::signbit(sample) ? -1. : 1.; }
+inline iplug::sample clip(iplug::sample sample) { return sign(sample) * std::min(std::abs(sample), 1.); }
 
 class SineWaveshaper
 {
 public:
+  // Indices of the built-in algorithms in waveshaper::Algorithms
   enum EAlgorithms
   {
     kSinX = 0,
@@ -22,105 +30,385 @@ public:
     kSinXPowEuler
   };
 
-#if defined VST3_API || defined VST3C_API
-  static constexpr std::initializer_list<const char*> Algorithms = {
-    "sin(A*PI*x^B)^C",  "(x - sin(A*PI*x^B)^C) / 2", "(sin(x) - sin(A*PI*x^B*PI*)^C) / 2", "(sin(PI*x) - sin(A*PI*x^B)^C) / 2", "(1-x)(sin(A*PI*x^B)^C) + x", "(1-x)(sin(A*PI*(-x)^B)^C) + x",
-    "sin(A*PI*x^B^e)^C"};
-#else
-  static constexpr std::initializer_list<const char*> Algorithms = {
-    "sin(Aπx^B)^C", "(x - sin(Aπx^B)^C) / 2", "(sin(x) - sin(Aπx^Bπ)^C) / 2", "(sin(πx) - sin(Aπx^B)^C) / 2", "(1-x)(sin(Aπx^B)^C) + x", "(1-x)(sin(Aπ(-x)^B)^C) + x", "sin(Aπx^B^e)^C"};
-#endif
+  /** Math of ProcessBlock(), from slowest to cheapest. ProcessSample() is always exact. */
+  enum EQuality
+  {
+    kExact = 0, // std::sin and std::pow, as ProcessSample()
+    kHigh,      // polynomials accurate to a few ulp
+    kEco        // polynomials accurate to about 1e-6
+  };
+
+  static constexpr int kNumAlgorithms = static_cast<int>(std::tuple_size<waveshaper::Algorithms>::value);
+
+  /** Display name of an algorithm for the Algorithm parameter */
+  static const char* GetAlgorithmName(int algorithm) { return AlgorithmInfo<waveshaper::Algorithms>::kNames[algorithm]; }
+  /** Short name of an algorithm for the tools */
+  static const char* GetAlgorithmId(int algorithm) { return AlgorithmInfo<waveshaper::Algorithms>::kIds[algorithm]; }
 
-  void SetAlgorithm(int algorithm) { mAlgorithm = static_cast<EAlgorithms>(algorithm); }
+  using SampleFunc = iplug::sample (*)(const SineWaveshaper&, iplug::sample);
+  template <typename T>
+  using BlockFunc = void (*)(const SineWaveshaper&, const T*, T*, int);
+
+  SineWaveshaper() { UpdateKernels(); }
+
+  void SetAlgorithm(int algorithm)
+  {
+    mAlgorithm = algorithm;
+    UpdateKernels();
+  }
   void SetSync(double sync) { mSync = sync; }
   void SetPull(double pull) { mPull = pull; }
   void SetDeform(double deform) { mDeform = deform; }
   void SetStages(double stages)
   {
+    mStages = stages;
     double baseStages;
     mStagePct = std::modf(stages, &baseStages);
     mBaseStages = static_cast<int>(baseStages);
     mOverStages = static_cast<int>(baseStages + std::ceil(mStagePct));
   }
-  void SetPreClip(bool clip) { mPreClip = clip; }
-  void SetPostClip(bool clip) { mPostClip = clip; }
-  iplug::sample ProcessSample(iplug::sample sample)
+  void SetPreClip(bool clip)
+  {
+    mPreClip = clip;
+    UpdateKernels();
+  }
+  void SetPostClip(bool clip)
+  {
+    mPostClip = clip;
+    UpdateKernels();
+  }
+  void SetQuality(EQuality quality)
+  {
+    mQuality = quality;
+    UpdateKernels();
+  }
+  int GetAlgorithm() const { return mAlgorithm; }
+  double GetSync() const { return mSync; }
+  double GetPull() const { return mPull; }
+  double GetDeform() const { return mDeform; }
+  double GetStages() const { return mStages; }
+  bool GetPreClip() const { return mPreClip; }
+  bool GetPostClip() const { return mPostClip; }
+  EQuality GetQuality() const { return mQuality; }
+
+  iplug::sample ProcessSample(iplug::sample sample) const { return mSampleFunc(*this, sample); }
+
+  /** Process a whole buffer with the vectorised kernel, using AVX2, SSE2 or NEON depending on the running CPU. in and out may alias.
+   * With kHigh sin/pow are polynomial approximations accurate to a few ulp, a single stage stays within 1e-12 of ProcessSample for |x| <= 1.
+   * Near the zero crossings of the sine (Deform < 1) and for every further stage the difference is scaled by the slope of the curve,
+   * exactly as reordering the scalar arithmetic would. kEco uses the cheaper simd::SinFast() and simd::PowFast(), twice as fast in double: for
+   * Deform >= 1 a single stage stays within 4e-6 * (1 + Sync * Pull) of ProcessSample for |x| <= 1 (Pull times e for kSinXPowEuler), that is
+   * 8e-6 at the defaults and 2.6e-4 for Sync 16 and Pull 4, where the curve aliases far above that. Deform < 1 scales it up near the zero
+   * crossings as above, to 4e-2 at Deform 0.25. kExact runs ProcessSample() for every sample, about 3.5 times slower than kHigh. */
+  void ProcessBlock(const iplug::sample* in, iplug::sample* out, int n) const { mBlockFunc(*this, in, out, n); }
+
+  /** Same as above in single precision, twice the lanes per vector. sin/pow keep about 1e-6 of absolute accuracy, the output differs from the
+   * double precision one by a few 1e-7 per stage where the curve is flat and by that times the slope elsewhere. */
+  void ProcessBlock(const float* in, float* out, int n) const { mBlockFuncF(*this, in, out, n); }
+
+private:
+  static constexpr int kNumQualities = kEco + 1;
+  static constexpr int kNumKernels = kNumAlgorithms * 4;
+  static constexpr int kNumBlockKernels = kNumQualities * kNumKernels;
+  static constexpr int kStageChunk = 16; // vectors processed stage by stage
+
+  int mAlgorithm = kSinX;
+  double mSync = 1.;
+  double mPull = 1.;
+  double mDeform = 1.;
+  double mStages = 1.;
+  int mBaseStages = 1;
+  int mOverStages = 1;
+  double mStagePct = 0.;
+  bool mPreClip = false;
+  bool mPostClip = false;
+  EQuality mQuality = kHigh;
+  SampleFunc mSampleFunc = nullptr;
+  BlockFunc<double> mBlockFunc = nullptr;
+  BlockFunc<float> mBlockFuncF = nullptr;
+
+private:
+  template <typename List>
+  struct AlgorithmInfo;
+  template <typename... A>
+  struct AlgorithmInfo<std::tuple<A...>>
+  {
+#if defined VST3_API || defined VST3C_API
+    static constexpr std::array<const char*, sizeof...(A)> kNames = {{A::kNameASCII...}};
+#else
+    static constexpr std::array<const char*, sizeof...(A)> kNames = {{A::kName...}};
+#endif
+    static constexpr std::array<const char*, sizeof...(A)> kIds = {{A::kId...}};
+  };
+  template <int I>
+  using Algorithm = std::tuple_element_t<I, waveshaper::Algorithms>;
+  static_assert(std::is_same<Algorithm<kSinXPowEuler>, waveshaper::SinXPowEuler>::value, "EAlgorithms must follow waveshaper::Algorithms");
+
+  iplug::sample SinX(iplug::sample x) const
+  {
+    const auto s = std::sin(mSync * std::pow(x, mPull) * iplug::PI);
+    if (!s)
+      return s;
+    return sign(s) * std::pow(std::abs(s), mDeform);
+  }
+  iplug::sample SinXPowEuler(iplug::sample x) const
+  {
+    const auto s = std::sin(mSync * std::pow(std::pow(x, mPull), e) * iplug::PI);
+    if (!s)
+      return s;
+    return sign(s) * std::pow(std::abs(s), mDeform);
+  }
+
+  // The terms of the algorithms, exact for ProcessSample() and in the math of quality Q for ProcessBlock()
+  struct ScalarTerms
+  {
+    const SineWaveshaper& ws;
+    iplug::sample SinX(iplug::sample x) const { return ws.SinX(x); }
+    iplug::sample SinXPowEuler(iplug::sample x) const { return ws.SinXPowEuler(x); }
+    iplug::sample Sin(iplug::sample x) const { return std::sin(x); }
+  };
+  template <EQuality Q>
+  struct VectorTerms
+  {
+    const SineWaveshaper& ws;
+    template <typename V>
+    V SinX(V x) const { return ws.SinXV<Q>(x); }
+    template <typename V>
+    V SinXPowEuler(V x) const { return ws.SinXPowEulerV<Q>(x); }
+    template <typename V>
+    V Sin(V x) const { return SinV<Q>(x); }
+  };
+
+  template <typename A>
+  iplug::sample ApplyAlgorithm(iplug::sample x) const { return A::Apply(ScalarTerms{*this}, x); }
+
+  template <EQuality Q, typename V>
+  static V SinV(V x)
+  {
+    if constexpr (Q == kEco)
+      return iplug::simd::SinFast(x);
+    else
+      return iplug::simd::Sin(x);
+  }
+  template <EQuality Q, typename V>
+  static V PowV(V x, V y)
+  {
+    if constexpr (Q == kEco)
+      return iplug::simd::PowFast(x, y);
+    else
+      return iplug::simd::Pow(x, y);
+  }
+  template <EQuality Q, typename V>
+  V SinXV(V x) const
+  {
+    const V s = SinV<Q>(V::Set(mSync * iplug::PI) * PowV<Q>(x, V::Set(mPull)));
+    return V::Xor(PowV<Q>(V::Abs(s), V::Set(mDeform)), V::SignBit(s));
+  }
+  template <EQuality Q, typename V>
+  V SinXPowEulerV(V x) const
+  {
+    const V s = SinV<Q>(V::Set(mSync * iplug::PI) * PowV<Q>(x, V::Set(mPull * e)));
+    return V::Xor(PowV<Q>(V::Abs(s), V::Set(mDeform)), V::SignBit(s));
+  }
+  template <EQuality Q, typename A, typename V>
+  V ApplyAlgorithmV(V x) const { return A::ApplyV(VectorTerms<Q>{*this}, x); }
+
+  // Stages 1..mBaseStages-1 are full stages. A fractional Stages value interpolates stage mBaseStages and adds one full stage after it.
+  // A stage that returns its input has reached a fixed point (0 for every algorithm, 1 for the bound ones), the remaining stages are skipped.
+  template <typename A, bool PreClip, bool PostClip>
+  static iplug::sample ProcessSampleKernel(const SineWaveshaper& ws, iplug::sample sample)
   {
     auto signMul = sign(sample);
     auto uInput = std::abs(sample);
-    if (mPreClip)
+    if (PreClip)
       uInput = std::min(uInput, 1.);
 
-    auto post = uInput;
-    for (int i = 1; i <= mOverStages; i++)
+    auto stage = [&](iplug::sample post) {
+      const bool fixed = post == uInput;
+      signMul *= sign(post);
+      uInput = std::abs(post);
+      return fixed;
+    };
+    bool fixed = false;
+    for (int i = 1; i < ws.mBaseStages && !fixed; i++)
+      fixed = stage(ws.ApplyAlgorithm<A>(uInput));
+    if (!fixed && ws.mStagePct > 0.)
+    {
+      const auto post = ws.ApplyAlgorithm<A>(uInput);
+      fixed = post == uInput;
+      stage(iplug::Lerp(uInput, post, ws.mStagePct));
+    }
+    if (!fixed)
+      stage(ws.ApplyAlgorithm<A>(uInput));
+
+    if (PostClip)
+      uInput = clip(uInput);
+    return uInput * signMul;
+  }
+
+  /** n <= kStageChunk * V::kSize samples, stage by stage: each pass runs one stage over all vectors, the fractional interpolation has its own pass
+   * and the last stage is fused with the output. A vector whose lanes all reached a fixed point drops out of the remaining passes. */
+  template <EQuality Q, typename A, bool PreClip, bool PostClip, typename V>
+  void ProcessStages(const typename V::Scalar* in, typename V::Scalar* out, int n) const
+  {
+    using Scalar = typename V::Scalar;
+    const int nVectors = (n + V::kSize - 1) / V::kSize;
+    V u[kStageChunk];
+    V signBits[kStageChunk]; // sign is carried as a sign bit mask, xor-ing sign bits is the same as multiplying by sign()
+    bool fixed[kStageChunk];
+
+    // The tail is padded with zeros, a fixed point
+    for (int v = 0; v < nVectors; v++)
     {
-      post = ApplyAlgoritm(uInput);
-      if (i == mBaseStages && mStagePct > 0.)
+      V x;
+      if ((v + 1) * V::kSize <= n)
+        x = V::Load(in + v * V::kSize);
+      else
       {
-        uInput = iplug::Lerp(uInput, post, mStagePct);
+        Scalar tail[V::kSize] = {};
+        std::copy(in + v * V::kSize, in + n, tail);
+        x = V::Load(tail);
       }
+      signBits[v] = V::SignBit(x);
+      u[v] = V::Abs(x);
+      if (PreClip)
+        u[v] = V::Min(u[v], V::Set(1.));
+      fixed[v] = false;
+    }
+
+    int nActive = nVectors;
+    auto applyStage = [&](int v) {
+      const V post = ApplyAlgorithmV<Q, A>(u[v]);
+      if (V::AllTrue(V::CmpEq(post, u[v])))
+      {
+        fixed[v] = true;
+        nActive--;
+      }
+      return post;
+    };
+    auto stage = [&](int v, V post) {
+      signBits[v] = V::Xor(signBits[v], V::SignBit(post));
+      u[v] = V::Abs(post);
+    };
+    for (int i = 1; i < mBaseStages && nActive; i++)
+      for (int v = 0; v < nVectors; v++)
+        if (!fixed[v])
+          stage(v, applyStage(v));
+    if (nActive && mStagePct > 0.)
+    {
+      const V stagePct = V::Set(mStagePct);
+      for (int v = 0; v < nVectors; v++)
+        if (!fixed[v])
+        {
+          const V post = applyStage(v);
+          stage(v, V::MulAdd(post - u[v], stagePct, u[v]));
+        }
+    }
+
+    // The last stage goes straight to the output
+    for (int v = 0; v < nVectors; v++)
+    {
+      if (!fixed[v])
+        stage(v, ApplyAlgorithmV<Q, A>(u[v]));
+      V y = u[v];
+      if (PostClip)
+        y = V::Min(y, V::Set(1.));
+      y = V::Xor(y, signBits[v]);
+      if ((v + 1) * V::kSize <= n)
+        y.Store(out + v * V::kSize);
       else
       {
-        uInput = post;
+        Scalar tail[V::kSize];
+        y.Store(tail);
+        std::copy(tail, tail + (n - v * V::kSize), out + v * V::kSize);
       }
-      signMul *= sign(uInput);
-      uInput = abs(uInput);
     }
+  }
 
-    if (mPostClip)
-      uInput = clip(uInput);
-    return uInput * signMul;
+  template <typename V>
+  struct BlockKernel
+  {
+    using Scalar = typename V::Scalar;
+
+    template <EQuality Q, typename A, bool PreClip, bool PostClip>
+    static void Process(const SineWaveshaper& ws, const Scalar* in, Scalar* out, int n)
+    {
+      if constexpr (Q == kExact)
+      {
+        for (int s = 0; s < n; s++)
+          out[s] = static_cast<Scalar>(ProcessSampleKernel<A, PreClip, PostClip>(ws, in[s]));
+        return;
+      }
+
+      constexpr int chunkSize = kStageChunk * V::kSize;
+      for (int s = 0; s < n; s += chunkSize)
+        ws.ProcessStages<Q, A, PreClip, PostClip, V>(in + s, out + s, std::min(chunkSize, n - s));
+    }
   };
+#if defined SIMD_X86
+  template <typename V>
+  struct BlockKernelAVX2
+  {
+    using Scalar = typename V::Scalar;
 
-private:
-  EAlgorithms mAlgorithm;
-  double mSync;
-  double mPull;
-  double mDeform;
-  int mBaseStages;
-  int mOverStages;
-  double mStagePct;
-  bool mPreClip;
-  bool mPostClip;
+    template <EQuality Q, typename A, bool PreClip, bool PostClip>
+    SIMD_TARGET_AVX2 SIMD_FLATTEN static void Process(const SineWaveshaper& ws, const Scalar* in, Scalar* out, int n)
+    {
+      BlockKernel<V>::template Process<Q, A, PreClip, PostClip>(ws, in, out, n);
+    }
+  };
+#endif
 
-private:
-  iplug::sample SinX(iplug::sample x)
+  // Kernel tables are indexed by (algorithm, pre clip, post clip), the block kernel tables by (quality, algorithm, pre clip, post clip)
+  static constexpr int KernelIndex(int algorithm, bool preClip, bool postClip) { return (algorithm * 2 + preClip) * 2 + postClip; }
+
+  template <int... I>
+  static constexpr std::array<SampleFunc, sizeof...(I)> MakeSampleTable(std::integer_sequence<int, I...>)
   {
-    const auto s = std::sin(mSync * std::pow(x, mPull) * iplug::PI);
-    if (!s)
-      return s;
-    return sign(s) * std::pow(std::abs(s), mDeform);
+    return {{&ProcessSampleKernel<Algorithm<I / 4>, (I & 2) != 0, (I & 1) != 0>...}};
   }
-  iplug::sample SinXPlusX(iplug::sample x) { return .5 * (x - SinX(x)); }
-  iplug::sample SinXPlusSinX(iplug::sample x) { return .5 * (std::sin(x) - SinX(x)); }
-  iplug::sample SinXPlusSinXPI(iplug::sample x) { return .5 * (std::sin(x * iplug::PI) - SinX(x)); }
-  iplug::sample SinXPlusXBound(iplug::sample x) { return (1. - x) * SinX(x) + x; }
-  iplug::sample SinXPlusNegXBound(iplug::sample x) { return (1. - x) * -SinX(x) + x; }
-  iplug::sample SinXPowEuler(iplug::sample x)
+  template <typename Kernel, int... I>
+  static constexpr std::array<BlockFunc<typename Kernel::Scalar>, sizeof...(I)> MakeBlockTable(std::integer_sequence<int, I...>)
   {
-    const auto s = std::sin(mSync * std::pow(std::pow(x, mPull), e) * iplug::PI);
-    if (!s)
-      return s;
-    return sign(s) * std::pow(std::abs(s), mDeform);
+    return {{&Kernel::template Process<static_cast<EQuality>(I / kNumKernels), Algorithm<I % kNumKernels / 4>, (I & 2) != 0, (I & 1) != 0>...}};
   }
-  iplug::sample ApplyAlgoritm(iplug::sample x)
+  template <typename Kernel>
+  static const BlockFunc<typename Kernel::Scalar>* GetKernelTable()
   {
-    switch (mAlgorithm)
+    static constexpr std::array<BlockFunc<typename Kernel::Scalar>, kNumBlockKernels> table = MakeBlockTable<Kernel>(std::make_integer_sequence<int, kNumBlockKernels>());
+    return table.data();
+  }
+  /** The kernels for samples of type T */
+  template <typename T>
+  static const BlockFunc<T>* GetBlockTable()
+  {
+    using namespace iplug::simd;
+    using Vectors = VectorTypes<T>;
+    switch (GetLevel())
     {
-    case kSinX:
-      return SinX(x);
-    case kSinXPlusX:
-      return SinXPlusX(x);
-    case kSinXPlusSinX:
-      return SinXPlusSinX(x);
-    case kSinXPlusSinXPI:
-      return SinXPlusSinXPI(x);
-    case kSinXPlusXBound:
-      return SinXPlusXBound(x);
-    case kSinXPlusNegXBound:
-      return SinXPlusNegXBound(x);
-    case kSinXPowEuler:
-      return SinXPowEuler(x);
+#if defined SIMD_X86
+    case ELevel::kAVX2:
+      return GetKernelTable<BlockKernelAVX2<typename Vectors::AVX2>>();
+    case ELevel::kSSE2:
+      return GetKernelTable<BlockKernel<typename Vectors::SSE2>>();
+#elif defined SIMD_NEON
+    case ELevel::kNEON:
+      return GetKernelTable<BlockKernel<typename Vectors::NEON>>();
+#endif
+    default:
+      return GetKernelTable<BlockKernel<typename Vectors::Scalar>>();
     }
   }
+
+  void UpdateKernels()
+  {
+    static constexpr std::array<SampleFunc, kNumKernels> sampleTable = MakeSampleTable(std::make_integer_sequence<int, kNumKernels>());
+    static const BlockFunc<double>* blockTable = GetBlockTable<double>();
+    static const BlockFunc<float>* blockTableF = GetBlockTable<float>();
+    const int idx = KernelIndex(mAlgorithm, mPreClip, mPostClip);
+    const int blockIdx = static_cast<int>(mQuality) * kNumKernels + idx;
+    mSampleFunc = sampleTable[idx];
+    mBlockFunc = blockTable[blockIdx];
+    mBlockFuncF = blockTableF[blockIdx];
+  }
 };
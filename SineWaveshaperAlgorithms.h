@@ -0,0 +1,104 @@
+#pragma once
+
+#include "IPlugConstants.h"
+#include <tuple>
+
+/** The algorithms of SineWaveshaper, one type per curve. SineWaveshaper generates its kernel tables, the parameter's display names and the
+ * benchmarks from Algorithms, so a curve added to the list gets the vectorised, single precision and quality paths without further changes.
+ *
+ * Every algorithm provides:
+ *   kId            a short name for the tools, no spaces
+ *   kName          the display name, kNameASCII where the host can't show unicode (VST3)
+ *   Apply(t, x)    the exact scalar curve for x >= 0, used by ProcessSample(), the Exact quality and the curve table
+ *   ApplyV(t, x)   the same curve on a SIMD vector V, see SIMD.h, for the High and Eco qualities
+ * t provides the terms in the math of the path: t.SinX(x) is sin(Sync PI x^Pull)^Deform with the sign of the sine, t.SinXPowEuler(x) the same
+ * with x^Pull^e and t.Sin(x) a plain sine. Apply() and ApplyV() should match to the accuracy of ProcessBlock(), returning 0 for 0 keeps silence silent. */
+namespace waveshaper
+{
+struct SinX
+{
+  static constexpr const char* kId = "SinX";
+  static constexpr const char* kName = "sin(Aπx^B)^C";
+  static constexpr const char* kNameASCII = "sin(A*PI*x^B)^C";
+
+  template <typename T>
+  static iplug::sample Apply(const T& t, iplug::sample x) { return t.SinX(x); }
+  template <typename T, typename V>
+  static V ApplyV(const T& t, V x) { return t.SinX(x); }
+};
+
+struct SinXPlusX
+{
+  static constexpr const char* kId = "SinXPlusX";
+  static constexpr const char* kName = "(x - sin(Aπx^B)^C) / 2";
+  static constexpr const char* kNameASCII = "(x - sin(A*PI*x^B)^C) / 2";
+
+  template <typename T>
+  static iplug::sample Apply(const T& t, iplug::sample x) { return .5 * (x - t.SinX(x)); }
+  template <typename T, typename V>
+  static V ApplyV(const T& t, V x) { return V::Set(.5) * (x - t.SinX(x)); }
+};
+
+struct SinXPlusSinX
+{
+  static constexpr const char* kId = "SinXPlusSinX";
+  static constexpr const char* kName = "(sin(x) - sin(Aπx^Bπ)^C) / 2";
+  static constexpr const char* kNameASCII = "(sin(x) - sin(A*PI*x^B*PI*)^C) / 2";
+
+  template <typename T>
+  static iplug::sample Apply(const T& t, iplug::sample x) { return .5 * (t.Sin(x) - t.SinX(x)); }
+  template <typename T, typename V>
+  static V ApplyV(const T& t, V x) { return V::Set(.5) * (t.Sin(x) - t.SinX(x)); }
+};
+
+struct SinXPlusSinXPI
+{
+  static constexpr const char* kId = "SinXPlusSinXPI";
+  static constexpr const char* kName = "(sin(πx) - sin(Aπx^B)^C) / 2";
+  static constexpr const char* kNameASCII = "(sin(PI*x) - sin(A*PI*x^B)^C) / 2";
+
+  template <typename T>
+  static iplug::sample Apply(const T& t, iplug::sample x) { return .5 * (t.Sin(x * iplug::PI) - t.SinX(x)); }
+  template <typename T, typename V>
+  static V ApplyV(const T& t, V x) { return V::Set(.5) * (t.Sin(x * V::Set(iplug::PI)) - t.SinX(x)); }
+};
+
+struct SinXPlusXBound
+{
+  static constexpr const char* kId = "SinXPlusXBound";
+  static constexpr const char* kName = "(1-x)(sin(Aπx^B)^C) + x";
+  static constexpr const char* kNameASCII = "(1-x)(sin(A*PI*x^B)^C) + x";
+
+  template <typename T>
+  static iplug::sample Apply(const T& t, iplug::sample x) { return (1. - x) * t.SinX(x) + x; }
+  template <typename T, typename V>
+  static V ApplyV(const T& t, V x) { return V::MulAdd(V::Set(1.) - x, t.SinX(x), x); }
+};
+
+struct SinXPlusNegXBound
+{
+  static constexpr const char* kId = "SinXPlusNegXBound";
+  static constexpr const char* kName = "(1-x)(sin(Aπ(-x)^B)^C) + x";
+  static constexpr const char* kNameASCII = "(1-x)(sin(A*PI*(-x)^B)^C) + x";
+
+  template <typename T>
+  static iplug::sample Apply(const T& t, iplug::sample x) { return (1. - x) * -t.SinX(x) + x; }
+  template <typename T, typename V>
+  static V ApplyV(const T& t, V x) { return V::MulAdd(x - V::Set(1.), t.SinX(x), x); }
+};
+
+struct SinXPowEuler
+{
+  static constexpr const char* kId = "SinXPowEuler";
+  static constexpr const char* kName = "sin(Aπx^B^e)^C";
+  static constexpr const char* kNameASCII = "sin(A*PI*x^B^e)^C";
+
+  template <typename T>
+  static iplug::sample Apply(const T& t, iplug::sample x) { return t.SinXPowEuler(x); }
+  template <typename T, typename V>
+  static V ApplyV(const T& t, V x) { return t.SinXPowEuler(x); }
+};
+
+/** In the order of the Algorithm parameter, new curves go at the end to keep saved states valid */
+using Algorithms = std::tuple<SinX, SinXPlusX, SinXPlusSinX, SinXPlusSinXPI, SinXPlusXBound, SinXPlusNegXBound, SinXPowEuler>;
+} // namespace waveshaper
@@ -5,19 +5,25 @@
 #include "IGraphics.h"
 #include "IGraphicsStructs.h"
 #include "SineWaveshaper.h"
+#include "SnapshotBuffer.h"
+#include "ThreadPool.h"
 #include "widgets/Color.h"
 #include "widgets/RCStyle.h"
 
 BEGIN_IPLUG_NAMESPACE
 BEGIN_IGRAPHICS_NAMESPACE
 
-/** A panel control which can be styled with emboss etc. */
+/** A panel control which can be styled with emboss etc.
+ * The shaper comes from snapshots published by the plugin, never from an object another thread writes. Whenever the snapshot version, the zoom
+ * or the width changed, the curve is computed on a worker thread with the vectorised ProcessBlock(), and the drawing is cached in a layer until
+ * then, so redraws only blit. The previous curve stays on screen until the new one arrives. */
 class SineWaveshaperDisplay : public IControl
 {
 public:
-  SineWaveshaperDisplay(const IRECT& bounds, SineWaveshaper& waveshaper, const RCStyle& style = DEFAULT_RCSTYLE, float gridThickness = 1.f)
+  /** The control is the only consumer of shaper, see SnapshotBuffer */
+  SineWaveshaperDisplay(const IRECT& bounds, SnapshotBuffer<SineWaveshaper>& shaper, const RCStyle& style = DEFAULT_RCSTYLE, float gridThickness = 1.f)
     : IControl(bounds)
-    , mWaveshaper(waveshaper)
+    , mShaper(shaper)
     , mStyle(style)
     , mGridThickness(gridThickness)
   {
@@ -25,9 +31,31 @@ public:
 
   void Draw(IGraphics& g) override
   {
-    auto colorset = mStyle.GetColors();
-    DrawBG(g, colorset);
-    DrawData(g, colorset);
+    RequestCurve();
+    TakeCurve();
+    if (!g.CheckLayer(mLayer))
+    {
+      g.StartLayer(this, mRECT);
+      auto colorset = mStyle.GetColors();
+      DrawBG(g, colorset);
+      DrawData(g, colorset);
+      mLayer = g.EndLayer();
+    }
+    g.DrawLayer(mLayer);
+  }
+
+  /** Redraws when a new shaper was published or a curve computed by the worker is waiting */
+  bool IsDirty() override
+  {
+    if (mShaper.GetVersion() != mRequestedVersion || mComputed.load() != mDrawn)
+      SetDirty(false);
+    return IControl::IsDirty();
+  }
+
+  void SetDisabled(bool disable) override
+  {
+    IControl::SetDisabled(disable);
+    InvalidateLayer();
   }
 
   void DrawBG(IGraphics& g, WidgetColorSet colorset)
@@ -70,16 +98,7 @@ public:
   void DrawData(IGraphics& g, WidgetColorSet colorset)
   {
     const auto bounds = mRECT.GetPadded(-mStyle.frameThickness);
-    const auto w = std::ceil(bounds.W());
     const auto h = std::ceil(bounds.H());
-    mData.resize(w + 1);
-
-    for (int i = 0; i <= w; i++)
-    {
-      const auto x = i / w * 2.f - 1.f;
-      const auto y = mWaveshaper.ProcessSample(x * mZoomFactor);
-      mData[i] = static_cast<float>(y / mZoomFactor);
-    }
 
     float xPos = bounds.L;
     float yPos = bounds.T;
@@ -126,6 +145,13 @@ public:
     g.PathFill(colorset.GetColor().WithOpacity(.382f), IFillOptions(true), &mBlend);
   }
 
+  /** Right click triggers the action function */
+  void OnMouseDown(float x, float y, const IMouseMod& mod) override
+  {
+    if (mod.R)
+      SetDirty(true);
+  }
+
   void OnMouseDblClick(float x, float y, const IMouseMod& mod) { SetZoomFactor(1.f); }
 
   void OnMouseWheel(float x, float y, const IMouseMod& mod, float d) override
@@ -142,6 +168,7 @@ public:
   {
     mZoomFactor = Clip<float>(factor, .5f, 2.f);
     recalculateGrid();
+    InvalidateLayer();
     SetDirty(false);
   };
 
@@ -149,6 +176,7 @@ public:
   {
     SetTargetRECT(mRECT);
     recalculateGrid();
+    InvalidateLayer();
     SetDirty(false);
   }
 
@@ -166,12 +194,75 @@ public:
   }
 
 private:
-  SineWaveshaper& mWaveshaper;
+  SnapshotBuffer<SineWaveshaper>& mShaper;
   RCStyle mStyle;
   float mGridThickness;
-  std::vector<float> mData;
+  std::vector<float> mData; // the curve drawn into mLayer, one point per pixel column
   float mZoomFactor = 1.f;
   std::vector<float> mGridPcts = {.5f};
+  ILayerPtr mLayer;
+
+  // What the worker was last asked for, only touched by the UI thread
+  int mRequestedVersion = -1;
+  float mRequestedZoom = 0.f;
+  int mRequestedWidth = -1;
+  int mDrawn = 0; // the request mData belongs to
+
+  // Requests are numbered, the worker skips all but the newest and hands its result over in mResult
+  std::atomic<int> mRequests{0};
+  std::atomic<int> mComputed{0};
+  std::mutex mResultMutex;
+  std::vector<float> mResult;
+  ThreadPool mWorker{1}; // last, its thread stops before the members it uses go away
+
+  void InvalidateLayer()
+  {
+    if (mLayer)
+      mLayer->Invalidate();
+  }
+
+  /** Asks the worker for the curve when the shaper version, the zoom or the width differ from the last request */
+  void RequestCurve()
+  {
+    mShaper.Acquire();
+    const int version = mShaper.GetAcquiredVersion();
+    const int width = static_cast<int>(std::ceil(mRECT.GetPadded(-mStyle.frameThickness).W()));
+    if (mRequestedVersion == version && mRequestedZoom == mZoomFactor && mRequestedWidth == width)
+      return;
+    mRequestedVersion = version;
+    mRequestedZoom = mZoomFactor;
+    mRequestedWidth = width;
+
+    // Double precision: with Deform below 1 the float and kEco paths visibly miss the points right at the zero crossings of the sine
+    const int request = ++mRequests;
+    mWorker.Submit([this, shaper = mShaper.Get(), zoom = mZoomFactor, width, request] {
+      if (request != mRequests.load())
+        return;
+      std::vector<sample> curve(width + 1);
+      const float w = static_cast<float>(width);
+      for (int i = 0; i <= width; i++)
+        curve[i] = (i / w * 2.f - 1.f) * zoom;
+      shaper.ProcessBlock(curve.data(), curve.data(), width + 1);
+      std::vector<float> data(width + 1);
+      for (int i = 0; i <= width; i++)
+        data[i] = static_cast<float>(curve[i] / zoom);
+      std::lock_guard<std::mutex> lock(mResultMutex);
+      mResult.swap(data);
+      mComputed.store(request);
+    });
+  }
+
+  /** Moves a finished curve into mData */
+  void TakeCurve()
+  {
+    std::lock_guard<std::mutex> lock(mResultMutex);
+    const int computed = mComputed.load();
+    if (computed == mDrawn)
+      return;
+    mData.swap(mResult);
+    mDrawn = computed;
+    InvalidateLayer();
+  }
 
   void recalculateGrid()
   {
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+
+/** Lock-free handoff of a complete value from a producer to the audio thread, a triple buffer like the one of TransferCurveTable.
+ * Publish() copies into a slot the consumer can't be reading and then makes it the newest, Acquire() picks up the newest slot.
+ * Neither side blocks and the consumer never sees a partially written value, every field changes at once.
+ * Publish() must not run on two threads at the same time, Acquire() and Get() belong to a single consumer thread. */
+template <typename T>
+class SnapshotBuffer
+{
+public:
+  explicit SnapshotBuffer(const T& initial = T())
+  {
+    for (auto& slot : mSlots)
+      slot.value = initial;
+  }
+
+  SnapshotBuffer(const SnapshotBuffer&) = delete;
+  SnapshotBuffer& operator=(const SnapshotBuffer&) = delete;
+
+  void Publish(const T& value)
+  {
+    const int front = mFront.load();
+    const int inUse = mInUse.load();
+    int slot = 0;
+    while (slot == front || slot == inUse)
+      slot++;
+
+    mSlots[slot].value = value;
+    mSlots[slot].version = mVersion.load() + 1;
+    mFront.store(slot);
+    mVersion.store(mSlots[slot].version);
+  }
+
+  /** Version of the newest published value, counting from 0 for the initial value. Any thread. */
+  int GetVersion() const { return mVersion.load(); }
+
+  /** Called by the consumer at the start of a block, returns true when a newer value was picked up */
+  bool Acquire()
+  {
+    int slot;
+    do
+    {
+      slot = mFront.load();
+      mInUse.store(slot);
+    } while (mFront.load() != slot);
+
+    // The previous slot may already be rewritten, only the copy of its version is safe to compare
+    const int previousVersion = mCurrentVersion;
+    mCurrent = slot;
+    mCurrentVersion = mSlots[slot].version;
+    return mCurrentVersion != previousVersion;
+  }
+
+  /** The value picked up by the last Acquire() */
+  const T& Get() const { return mSlots[mCurrent].value; }
+  int GetAcquiredVersion() const { return mCurrentVersion; }
+
+private:
+  struct Slot
+  {
+    T value;
+    int version = 0;
+  };
+
+  std::array<Slot, 3> mSlots;
+  std::atomic<int> mFront{0};
+  std::atomic<int> mInUse{0};
+  std::atomic<int> mVersion{0};
+  int mCurrent = 0;
+  int mCurrentVersion = 0;
+};
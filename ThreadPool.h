@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/** Work-stealing thread pool. Every worker owns a task queue and takes its newest task first; an idle worker steals the oldest task of another queue.
+ * Submit() spreads tasks round-robin over the queues, Wait() lets the calling thread help until every submitted task has finished. */
+class ThreadPool
+{
+public:
+  using Task = std::function<void()>;
+
+  /** nThreads <= 0 uses one thread per hardware thread */
+  explicit ThreadPool(int nThreads = 0)
+  {
+    if (nThreads <= 0)
+      nThreads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    for (int i = 0; i < nThreads; i++)
+      mQueues.emplace_back(new Queue);
+    for (int i = 0; i < nThreads; i++)
+      mThreads.emplace_back([this, i] { WorkerLoop(i); });
+  }
+
+  /** Tasks that are still queued are dropped, call Wait() first to finish them */
+  ~ThreadPool()
+  {
+    {
+      std::lock_guard<std::mutex> lock(mWakeMutex);
+      mStop = true;
+    }
+    mWake.notify_all();
+    for (auto& thread : mThreads)
+      thread.join();
+  }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  int NThreads() const { return static_cast<int>(mThreads.size()); }
+
+  void Submit(Task task)
+  {
+    mPending++;
+    Queue& queue = *mQueues[mNextQueue++ % mQueues.size()];
+    {
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      queue.tasks.push_back(std::move(task));
+    }
+    {
+      std::lock_guard<std::mutex> lock(mWakeMutex);
+      mQueued++;
+    }
+    mWake.notify_one();
+  }
+
+  /** Blocks until all submitted tasks have run, executing queued tasks on the calling thread meanwhile */
+  void Wait()
+  {
+    Task task;
+    while (mPending.load())
+    {
+      if (Steal(0, task))
+        Run(task);
+      else
+      {
+        std::unique_lock<std::mutex> lock(mWakeMutex);
+        mDone.wait(lock, [this] { return !mPending.load() || mQueued > 0; });
+      }
+    }
+  }
+
+private:
+  struct Queue
+  {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  bool Pop(int idx, Task& task)
+  {
+    Queue& queue = *mQueues[idx];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty())
+      return false;
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    Dequeued();
+    return true;
+  }
+
+  bool Steal(int idx, Task& task)
+  {
+    const int nQueues = static_cast<int>(mQueues.size());
+    for (int i = 0; i < nQueues; i++)
+    {
+      Queue& queue = *mQueues[(idx + i) % nQueues];
+      std::lock_guard<std::mutex> lock(queue.mutex);
+      if (queue.tasks.empty())
+        continue;
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      Dequeued();
+      return true;
+    }
+    return false;
+  }
+
+  void Dequeued()
+  {
+    std::lock_guard<std::mutex> lock(mWakeMutex);
+    mQueued--;
+  }
+
+  void Run(Task& task)
+  {
+    task();
+    task = nullptr;
+    if (--mPending == 0)
+    {
+      // Taking the lock orders the notification after a waiter has checked its predicate
+      std::lock_guard<std::mutex> lock(mWakeMutex);
+      mDone.notify_all();
+    }
+  }
+
+  void WorkerLoop(int idx)
+  {
+    Task task;
+    while (true)
+    {
+      if (Pop(idx, task) || Steal(idx + 1, task))
+      {
+        Run(task);
+        continue;
+      }
+      std::unique_lock<std::mutex> lock(mWakeMutex);
+      mWake.wait(lock, [this] { return mStop || mQueued > 0; });
+      if (mStop)
+        return;
+    }
+  }
+
+  std::vector<std::unique_ptr<Queue>> mQueues;
+  std::vector<std::thread> mThreads;
+  std::atomic<unsigned> mNextQueue{0};
+  std::atomic<int> mPending{0};
+  std::mutex mWakeMutex;
+  std::condition_variable mWake;
+  std::condition_variable mDone;
+  int mQueued = 0;
+  bool mStop = false;
+};
@@ -0,0 +1,311 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+
+#include "SineWaveshaper.h"
+
+/** Bakes the complete multi-stage SineWaveshaper curve into a lookup table so the cost per sample no longer depends on Stages.
+ * The curve is odd, so only |x| in [0, range] is stored. Inputs beyond the range fall back to the exact ProcessSample.
+ * Build() runs on a non-realtime thread into a free slot of a triple buffer, the audio thread picks up the newest slot with Acquire().
+ *
+ * The table also carries the first and second antiderivatives of its piecewise linear curve for antiderivative anti-aliasing (ADAA).
+ * They are exact for that curve, so the ADAA output is the mean of the table curve over the path between samples. */
+class TransferCurveTable
+{
+public:
+  enum EInterpolation
+  {
+    kLinear = 0,
+    kCubic
+  };
+
+  /** Previous inputs of one channel for ProcessBlockADAA() */
+  struct ADAAState
+  {
+    double x1 = 0.;
+    double x2 = 0.;
+  };
+
+  static constexpr int kDefaultSize = 8192;
+  static constexpr double kDefaultRange = 2.;
+
+  TransferCurveTable(int size = kDefaultSize, double range = kDefaultRange)
+  {
+    for (auto& slot : mSlots)
+      slot.version.store(-1);
+    SetSize(size, range);
+  }
+
+  TransferCurveTable(const TransferCurveTable&) = delete;
+  TransferCurveTable& operator=(const TransferCurveTable&) = delete;
+
+  /** Not realtime safe, also invalidates the current tables */
+  void SetSize(int size, double range)
+  {
+    mSize = std::max(size, 4);
+    mRange = range;
+    // One guard point below zero and two past the range for the cubic interpolation
+    for (auto& slot : mSlots)
+    {
+      slot.data.assign(mSize + 3, 0.);
+      slot.first.assign(mSize, 0.);
+      slot.second.assign(mSize, 0.);
+      slot.version.store(-1);
+    }
+  }
+
+  void SetInterpolation(EInterpolation interpolation) { mInterpolation = interpolation; }
+  double GetRange() const { return mRange; }
+
+  /** Version of the most recently built table, -1 when none has been built */
+  int GetVersion() const { return mSlots[mFront.load()].version.load(); }
+
+  /** Fill a free slot from the curve of shaper and publish it tagged with version. Call from a single non-realtime thread. */
+  void Build(const SineWaveshaper& shaper, int version)
+  {
+    const int front = mFront.load();
+    const int inUse = mInUse.load();
+    int slot = 0;
+    while (slot == front || slot == inUse)
+      slot++;
+
+    auto& data = mSlots[slot].data;
+    const double step = mRange / (mSize - 1);
+    for (int i = 0; i < mSize + 3; i++)
+      data[i] = shaper.ProcessSample((i - 1) * step);
+
+    // Antiderivatives from 0 at every table point, integrating the linear segments exactly
+    auto& first = mSlots[slot].first;
+    auto& second = mSlots[slot].second;
+    const double* curve = data.data() + 1;
+    first[0] = second[0] = 0.;
+    for (int i = 1; i < mSize; i++)
+    {
+      const double f0 = curve[i - 1];
+      const double d = curve[i] - f0;
+      first[i] = first[i - 1] + (f0 + .5 * d) * step;
+      second[i] = second[i - 1] + first[i - 1] * step + (.5 * f0 + d / 6.) * step * step;
+    }
+
+    mSlots[slot].version.store(version);
+    mFront.store(slot);
+  }
+
+  /** Called by the audio thread at the start of a block. Returns true when the newest table was built for version. */
+  bool Acquire(int version)
+  {
+    int slot;
+    do
+    {
+      slot = mFront.load();
+      mInUse.store(slot);
+    } while (mFront.load() != slot);
+
+    mCurrent = slot;
+    return mSlots[slot].version.load() == version;
+  }
+
+  /** Look up the acquired table, out-of-range inputs go through shaper.ProcessSample. in and out may alias.
+   * The table is only as detailed as its size allows, curves that oscillate faster than the table step (high Sync with many Stages) are smoothed.
+   * T is double or float, the lookup itself always runs in double. */
+  template <typename T>
+  void ProcessBlock(const SineWaveshaper& shaper, const T* in, T* out, int n) const
+  {
+    if (mInterpolation == kCubic)
+      ProcessBlock<kCubic, T>(shaper, in, out, n);
+    else
+      ProcessBlock<kLinear, T>(shaper, in, out, n);
+  }
+
+  /** Antiderivative anti-aliasing of the acquired table, order 1 or 2. Delays the signal by order / 2 samples.
+   * Samples whose path leaves the table range use the exact ProcessSample of the same delayed input. in and out may alias. */
+  template <typename T>
+  void ProcessBlockADAA(int order, const SineWaveshaper& shaper, const T* in, T* out, int n, ADAAState& state) const
+  {
+    if (order == 2)
+      ProcessBlockADAA2(shaper, in, out, n, state);
+    else
+      ProcessBlockADAA1(shaper, in, out, n, state);
+  }
+
+  /** ADAA applied to f(x) = x, the delay of ProcessBlockADAA() for a signal that should stay aligned with it (e.g. the dry signal) */
+  template <typename T>
+  static void DelayLikeADAA(int order, const T* in, T* out, int n, ADAAState& state)
+  {
+    for (int s = 0; s < n; s++)
+    {
+      const double x0 = in[s];
+      out[s] = static_cast<T>(order == 2 ? (x0 + state.x1 + state.x2) / 3. : .5 * (x0 + state.x1));
+      state.x2 = state.x1;
+      state.x1 = x0;
+    }
+  }
+
+private:
+  struct Slot
+  {
+    std::vector<double> data;
+    std::vector<double> first;
+    std::vector<double> second;
+    std::atomic<int> version;
+  };
+
+  // Below this difference between inputs the divided differences lose precision and the midpoint is evaluated instead
+  static constexpr double kADAATolerance = 1e-6;
+
+  double Curve(const double* table, double x) const
+  {
+    const double pos = std::abs(x) * (mSize - 1) / mRange;
+    const int i = static_cast<int>(pos);
+    const double y = table[i] + (table[i + 1] - table[i]) * (pos - i);
+    return std::signbit(x) ? -y : y;
+  }
+
+  // First (even) and second (odd) antiderivatives of the table curve at x
+  void Antiderivatives(const Slot& slot, double x, double& first, double& second) const
+  {
+    const double step = mRange / (mSize - 1);
+    const double pos = std::abs(x) / step;
+    const int i = std::min(static_cast<int>(pos), mSize - 2);
+    const double u = (pos - i) * step;
+    const double f0 = slot.data[i + 1];
+    const double slope = (slot.data[i + 2] - f0) / step;
+    first = slot.first[i] + (f0 + .5 * slope * u) * u;
+    second = slot.second[i] + (slot.first[i] + (.5 * f0 + slope * u / 6.) * u) * u;
+    if (std::signbit(x))
+      second = -second;
+  }
+
+  double First(const Slot& slot, double x) const
+  {
+    double first, second;
+    Antiderivatives(slot, x, first, second);
+    return first;
+  }
+
+  template <typename T>
+  void ProcessBlockADAA1(const SineWaveshaper& shaper, const T* in, T* out, int n, ADAAState& state) const
+  {
+    const Slot& slot = mSlots[mCurrent];
+    const double* table = slot.data.data() + 1;
+    double x1 = state.x1;
+    double first1 = std::abs(x1) < mRange ? First(slot, x1) : 0.;
+    for (int s = 0; s < n; s++)
+    {
+      const double x0 = in[s];
+      const double first0 = std::abs(x0) < mRange ? First(slot, x0) : 0.;
+      if (std::abs(x0) >= mRange || std::abs(x1) >= mRange)
+        out[s] = static_cast<T>(shaper.ProcessSample(.5 * (x0 + x1)));
+      else if (std::abs(x0 - x1) < kADAATolerance)
+        out[s] = static_cast<T>(Curve(table, .5 * (x0 + x1)));
+      else
+        out[s] = static_cast<T>((first0 - first1) / (x0 - x1));
+
+      state.x2 = x1;
+      x1 = x0;
+      first1 = first0;
+    }
+    state.x1 = x1;
+  }
+
+  template <typename T>
+  void ProcessBlockADAA2(const SineWaveshaper& shaper, const T* in, T* out, int n, ADAAState& state) const
+  {
+    const Slot& slot = mSlots[mCurrent];
+    const double* table = slot.data.data() + 1;
+    double x1 = state.x1;
+    double x2 = state.x2;
+    for (int s = 0; s < n; s++)
+    {
+      const double x0 = in[s];
+      if (std::max(std::abs(x0), std::max(std::abs(x1), std::abs(x2))) >= mRange)
+      {
+        out[s] = static_cast<T>(shaper.ProcessSample((x0 + x1 + x2) / 3.));
+      }
+      else
+      {
+        double first0, second0, first1, second1, first2, second2;
+        Antiderivatives(slot, x0, first0, second0);
+        Antiderivatives(slot, x1, first1, second1);
+        Antiderivatives(slot, x2, first2, second2);
+
+        // Divided difference of the second antiderivative, the first antiderivative at the midpoint when ill-conditioned
+        auto divided = [&](double a, double b, double secondA, double secondB) {
+          if (std::abs(a - b) < kADAATolerance)
+            return First(slot, .5 * (a + b));
+          return (secondA - secondB) / (a - b);
+        };
+
+        if (std::abs(x0 - x2) < kADAATolerance)
+        {
+          const double xBar = .5 * (x0 + x2);
+          const double delta = xBar - x1;
+          if (std::abs(delta) < kADAATolerance)
+          {
+            out[s] = static_cast<T>(Curve(table, .5 * (xBar + x1)));
+          }
+          else
+          {
+            double firstBar, secondBar;
+            Antiderivatives(slot, xBar, firstBar, secondBar);
+            out[s] = static_cast<T>(2. / delta * (firstBar + (second1 - secondBar) / delta));
+          }
+        }
+        else
+        {
+          out[s] = static_cast<T>(2. / (x0 - x2) * (divided(x0, x1, second0, second1) - divided(x1, x2, second1, second2)));
+        }
+      }
+      x2 = x1;
+      x1 = x0;
+    }
+    state.x1 = x1;
+    state.x2 = x2;
+  }
+
+  template <EInterpolation I, typename T>
+  void ProcessBlock(const SineWaveshaper& shaper, const T* in, T* out, int n) const
+  {
+    const double* table = mSlots[mCurrent].data.data() + 1;
+    const double scale = (mSize - 1) / mRange;
+    for (int s = 0; s < n; s++)
+    {
+      const double x = in[s];
+      const double pos = std::abs(x) * scale;
+      if (!(pos < mSize - 1))
+      {
+        out[s] = static_cast<T>(shaper.ProcessSample(x));
+        continue;
+      }
+
+      const int i = static_cast<int>(pos);
+      const double frac = pos - i;
+      double y;
+      if (I == kCubic)
+      {
+        // Catmull-Rom
+        const double y0 = table[i - 1], y1 = table[i], y2 = table[i + 1], y3 = table[i + 2];
+        const double b = .5 * (y2 - y0);
+        const double c = y0 - 2.5 * y1 + 2. * y2 - .5 * y3;
+        const double d = .5 * (y3 - y0) + 1.5 * (y1 - y2);
+        y = ((d * frac + c) * frac + b) * frac + y1;
+      }
+      else
+      {
+        y = table[i] + (table[i + 1] - table[i]) * frac;
+      }
+      out[s] = static_cast<T>(std::signbit(x) ? -y : y);
+    }
+  }
+
+  Slot mSlots[3];
+  std::atomic<int> mFront{0};
+  std::atomic<int> mInUse{0};
+  int mCurrent = 0;
+  int mSize = kDefaultSize;
+  double mRange = kDefaultRange;
+  EInterpolation mInterpolation = kLinear;
+};
@@ -15,7 +15,7 @@
 
 #define SHARED_RESOURCES_SUBPATH "RCSiner"
 
-#define PLUG_CHANNEL_IO "1-1 2-2"
+#define PLUG_CHANNEL_IO "1-1 2-2 6-6 8-8 12-12"
 
 #define PLUG_LATENCY 0
 #define PLUG_TYPE 0
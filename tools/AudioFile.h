@@ -0,0 +1,255 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/** Streaming reader for WAV (PCM 16/24/32 bit, float 32/64 bit, also WAVE_FORMAT_EXTENSIBLE) and headerless interleaved float32 files.
+ * Samples are returned interleaved as doubles. Assumes a little-endian host. */
+class AudioFileReader
+{
+public:
+  ~AudioFileReader() { Close(); }
+
+  bool OpenWav(const char* path)
+  {
+    if (!Open(path))
+      return false;
+
+    char riff[12];
+    if (fread(riff, 1, 12, mFile) != 12 || memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4))
+      return Fail("not a RIFF/WAVE file");
+
+    bool hasFormat = false;
+    char header[8];
+    while (fread(header, 1, 8, mFile) == 8)
+    {
+      uint32_t size;
+      memcpy(&size, header + 4, 4);
+      if (!memcmp(header, "fmt ", 4))
+      {
+        std::vector<uint8_t> fmt(size);
+        if (size < 16 || fread(fmt.data(), 1, size, mFile) != size)
+          return Fail("truncated fmt chunk");
+        uint16_t format, channels, bits;
+        uint32_t rate;
+        memcpy(&format, &fmt[0], 2);
+        memcpy(&channels, &fmt[2], 2);
+        memcpy(&rate, &fmt[4], 4);
+        memcpy(&bits, &fmt[14], 2);
+        // WAVE_FORMAT_EXTENSIBLE keeps the actual format in the first two bytes of the sub format GUID
+        if (format == 0xFFFE && size >= 26)
+          memcpy(&format, &fmt[24], 2);
+        if (!((format == 1 && (bits == 16 || bits == 24 || bits == 32)) || (format == 3 && (bits == 32 || bits == 64))))
+          return Fail("unsupported sample format");
+        mFormat = format == 3 ? (bits == 32 ? kFloat32 : kFloat64) : (bits == 16 ? kInt16 : bits == 24 ? kInt24 : kInt32);
+        mNChannels = channels;
+        mSampleRate = rate;
+        hasFormat = true;
+        if (size & 1)
+          fseek(mFile, 1, SEEK_CUR);
+      }
+      else if (!memcmp(header, "data", 4))
+      {
+        if (!hasFormat || !mNChannels)
+          return Fail("data chunk before fmt chunk");
+        mNFrames = size / (BytesPerSample() * mNChannels);
+        return true;
+      }
+      else
+        fseek(mFile, size + (size & 1), SEEK_CUR);
+    }
+    return Fail("no data chunk");
+  }
+
+  bool OpenRaw(const char* path, int nChannels, double sampleRate)
+  {
+    if (!Open(path))
+      return false;
+    mFormat = kFloat32;
+    mNChannels = nChannels;
+    mSampleRate = sampleRate;
+    fseek(mFile, 0, SEEK_END);
+    mNFrames = ftell(mFile) / (BytesPerSample() * nChannels);
+    fseek(mFile, 0, SEEK_SET);
+    return true;
+  }
+
+  /** Reads up to maxFrames frames into interleaved, returns the number of frames read */
+  int Read(double* interleaved, int maxFrames)
+  {
+    const int64_t frames = std::min<int64_t>(maxFrames, mNFrames - mPosition);
+    if (frames <= 0)
+      return 0;
+    const int bytes = BytesPerSample();
+    const size_t nSamples = static_cast<size_t>(frames) * mNChannels;
+    mRaw.resize(nSamples * bytes);
+    const size_t read = fread(mRaw.data(), bytes, nSamples, mFile);
+    const uint8_t* p = mRaw.data();
+    for (size_t i = 0; i < read; i++, p += bytes)
+      interleaved[i] = Convert(p);
+    mPosition += read / mNChannels;
+    return static_cast<int>(read / mNChannels);
+  }
+
+  void Close()
+  {
+    if (mFile)
+      fclose(mFile);
+    mFile = nullptr;
+  }
+
+  int NChannels() const { return mNChannels; }
+  double GetSampleRate() const { return mSampleRate; }
+  int64_t NFrames() const { return mNFrames; }
+  const std::string& GetError() const { return mError; }
+
+private:
+  enum EFormat
+  {
+    kInt16,
+    kInt24,
+    kInt32,
+    kFloat32,
+    kFloat64
+  };
+
+  bool Open(const char* path)
+  {
+    Close();
+    mFile = fopen(path, "rb");
+    return mFile || Fail("cannot open file");
+  }
+
+  bool Fail(const char* error)
+  {
+    mError = error;
+    Close();
+    return false;
+  }
+
+  int BytesPerSample() const
+  {
+    static constexpr int bytes[] = {2, 3, 4, 4, 8};
+    return bytes[mFormat];
+  }
+
+  double Convert(const uint8_t* p) const
+  {
+    switch (mFormat)
+    {
+    case kInt16:
+    {
+      int16_t v;
+      memcpy(&v, p, 2);
+      return v / 32768.;
+    }
+    case kInt24:
+      return static_cast<int32_t>(static_cast<uint32_t>(p[0]) << 8 | static_cast<uint32_t>(p[1]) << 16 | static_cast<uint32_t>(p[2]) << 24) / 2147483648.;
+    case kInt32:
+    {
+      int32_t v;
+      memcpy(&v, p, 4);
+      return v / 2147483648.;
+    }
+    case kFloat32:
+    {
+      float v;
+      memcpy(&v, p, 4);
+      return v;
+    }
+    default:
+    {
+      double v;
+      memcpy(&v, p, 8);
+      return v;
+    }
+    }
+  }
+
+  FILE* mFile = nullptr;
+  EFormat mFormat = kFloat32;
+  int mNChannels = 0;
+  double mSampleRate = 0.;
+  int64_t mNFrames = 0;
+  int64_t mPosition = 0;
+  std::vector<uint8_t> mRaw;
+  std::string mError;
+};
+
+/** Streaming writer for 32 bit float WAV or headerless interleaved float32 files. The WAV sizes are patched in Close(). */
+class AudioFileWriter
+{
+public:
+  ~AudioFileWriter() { Close(); }
+
+  bool Open(const char* path, int nChannels, double sampleRate, bool wav)
+  {
+    Close();
+    mFile = fopen(path, "wb");
+    if (!mFile)
+      return false;
+    mNChannels = nChannels;
+    mWav = wav;
+    mNFrames = 0;
+    if (mWav)
+      WriteHeader(static_cast<uint32_t>(sampleRate));
+    return true;
+  }
+
+  bool Write(const double* interleaved, int nFrames)
+  {
+    const size_t nSamples = static_cast<size_t>(nFrames) * mNChannels;
+    mBuffer.resize(nSamples);
+    for (size_t i = 0; i < nSamples; i++)
+      mBuffer[i] = static_cast<float>(interleaved[i]);
+    mNFrames += nFrames;
+    return fwrite(mBuffer.data(), sizeof(float), nSamples, mFile) == nSamples;
+  }
+
+  void Close()
+  {
+    if (!mFile)
+      return;
+    if (mWav)
+    {
+      const uint32_t dataSize = static_cast<uint32_t>(mNFrames * mNChannels * sizeof(float));
+      const uint32_t riffSize = dataSize + 36;
+      fseek(mFile, 4, SEEK_SET);
+      fwrite(&riffSize, 4, 1, mFile);
+      fseek(mFile, 40, SEEK_SET);
+      fwrite(&dataSize, 4, 1, mFile);
+    }
+    fclose(mFile);
+    mFile = nullptr;
+  }
+
+private:
+  void WriteHeader(uint32_t sampleRate)
+  {
+    const uint16_t format = 3, channels = static_cast<uint16_t>(mNChannels), bits = 32;
+    const uint16_t blockAlign = channels * bits / 8;
+    const uint32_t byteRate = sampleRate * blockAlign, fmtSize = 16, zero = 0;
+    fwrite("RIFF", 1, 4, mFile);
+    fwrite(&zero, 4, 1, mFile);
+    fwrite("WAVEfmt ", 1, 8, mFile);
+    fwrite(&fmtSize, 4, 1, mFile);
+    fwrite(&format, 2, 1, mFile);
+    fwrite(&channels, 2, 1, mFile);
+    fwrite(&sampleRate, 4, 1, mFile);
+    fwrite(&byteRate, 4, 1, mFile);
+    fwrite(&blockAlign, 2, 1, mFile);
+    fwrite(&bits, 2, 1, mFile);
+    fwrite("data", 1, 4, mFile);
+    fwrite(&zero, 4, 1, mFile);
+  }
+
+  FILE* mFile = nullptr;
+  int mNChannels = 0;
+  bool mWav = true;
+  int64_t mNFrames = 0;
+  std::vector<float> mBuffer;
+};
@@ -0,0 +1,351 @@
+/*
+ Offline measurement of the aliasing of the waveshaper behind BlockOverSampler, to find the cheapest oversampling factor that is clean enough.
+ The test signals are tones on multiples of an odd bin g of a kFFTSize point FFT at 48kHz. They repeat exactly within the FFT, so no window
+ is needed, and every harmonic and intermodulation product falls on a multiple of g as well. Products that fold back at the (over)sampling rate,
+ a power of two multiple of kFFTSize bins, land off that grid. The spectrum of the settled output therefore splits exactly into the tones, their
+ products and the aliasing, together with the small noise of the filters. Only the audible band up to 20kHz counts: the filters can't remove
+ what folds back into their transition bands above it at any factor.
+
+ Signals: single tones near 100Hz, 1kHz, 3kHz, 8kHz and 15kHz at full scale (a stepped sweep) and two tones near 1kHz at half scale each,
+ all times the drive. Per configuration and factor it reports:
+   ASR     alias-to-signal ratio, the alias energy against the tones and their products, the worst of all signals, in dB
+   THD+N   everything but the tones against the tones, of the 1kHz tone, in dB
+ The recommended factor is the lowest one whose ASR stays below --threshold. Pre and post clip are off, the shaper runs with the High quality.
+
+ usage: RCSinerAlias [--algorithm N] [--sync A] [--pull B] [--deform C] [--stages N] [--drive DB] [--filter N] [--threshold DB] [--threads N]
+                     [--csv FILE] [--map FILE]
+   without parameter options the whole grid of AliasMap.h is measured, every option fixes one axis to its value
+   --filter     0 Low Latency (default), 1 Linear Phase
+   --threshold  default -60, the worst case is a full scale 15kHz tone
+   --threads    0 uses all cores (default)
+   --csv        write the table as CSV
+   --map        write the recommended factors of the whole grid as AliasMapData.h, needs the default --filter and no parameter options
+*/
+
+#define ALIAS_MAP_GENERATOR
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "AliasMap.h"
+#include "BlockOversampler.h"
+#include "FFT.h"
+#include "SineWaveshaper.h"
+#include "ThreadPool.h"
+
+using namespace iplug;
+
+static constexpr double kSampleRate = 48000.;
+static constexpr int kFFTOrder = 12;
+static constexpr int kFFTSize = 1 << kFFTOrder;
+static constexpr int kSettleFrames = 4096; // far longer than the impulse responses of the filters down to the noise floor
+static constexpr int kBlockSize = 512;
+static constexpr double kMaxFrequency = 20000.; // the transition bands of the filters above pass some of what folds back there at any factor
+static constexpr double kFloorDB = -200.;
+
+static const char* kFactorNames[] = {"1x", "2x", "4x", "8x", "16x"};
+
+struct Signal
+{
+  const char* name;
+  int grid;               // bin g, every tone and product lies on a multiple of it
+  std::vector<int> tones; // bins
+  double amplitude;       // per tone, at 0dB drive
+};
+
+/** The odd bin closest to frequency */
+static int GetOddBin(double frequency)
+{
+  const int bin = static_cast<int>(std::lround(frequency * kFFTSize / kSampleRate));
+  return bin | 1;
+}
+
+static std::vector<Signal> MakeSignals()
+{
+  std::vector<Signal> signals;
+  static constexpr std::pair<const char*, double> kTones[] = {{"100Hz", 100.}, {"1kHz", 1000.}, {"3kHz", 3000.}, {"8kHz", 8000.}, {"15kHz", 15000.}};
+  for (const auto& tone : kTones)
+  {
+    const int bin = GetOddBin(tone.second);
+    signals.push_back({tone.first, bin, {bin}, 1.});
+  }
+  // 7 * 13 and 7 * 17, about 1066Hz and 1395Hz
+  signals.push_back({"two-tone", 7, {7 * 13, 7 * 17}, .5});
+  return signals;
+}
+
+struct Config
+{
+  int algorithm;
+  double sync, pull, deform, stages, drive;
+};
+
+struct Measurement
+{
+  double asr[kNumFactors];
+  double thdn[kNumFactors];
+  int recommended;
+};
+
+struct Energies
+{
+  double tones = 0.;
+  double products = 0.;
+  double alias = 0.;
+};
+
+static double PowerToDB(double ratio) { return std::max(10. * std::log10(std::max(ratio, 1e-300)), kFloorDB); }
+
+/** Settled output spectrum of one signal, split into the tones, the products on the grid and everything else */
+static Energies Measure(const SineWaveshaper& shaper, EFactor factor, EFilterType filterType, const Signal& signal, double drive)
+{
+  BlockOverSampler<double> oversampler(factor, 1, 1, kBlockSize, true, filterType);
+  const double amplitude = signal.amplitude * DBToAmp(drive);
+  auto processFunc = [&shaper](double** inputs, double** outputs, int nFrames) { shaper.ProcessBlock(inputs[0], outputs[0], nFrames); };
+
+  std::vector<double> input(kBlockSize);
+  std::vector<double> output(kSettleFrames + kFFTSize);
+  for (int start = 0; start < static_cast<int>(output.size()); start += kBlockSize)
+  {
+    const int n = std::min(kBlockSize, static_cast<int>(output.size()) - start);
+    for (int s = 0; s < n; s++)
+    {
+      // The phase wraps every kFFTSize frames, computing it from the frame index modulo kFFTSize keeps it exact
+      const int frame = (start + s) & (kFFTSize - 1);
+      double x = 0.;
+      for (int bin : signal.tones)
+        x += std::sin(2. * PI * ((static_cast<int64_t>(bin) * frame) & (kFFTSize - 1)) / kFFTSize);
+      input[s] = x * amplitude;
+    }
+    double* in = input.data();
+    double* out = output.data() + start;
+    oversampler.ProcessBlock(&in, &out, n, 1, 1, processFunc);
+  }
+
+  static const FFT<double> fft(kFFTOrder);
+  std::vector<std::complex<double>> spectrum(output.end() - kFFTSize, output.end());
+  fft.Transform(spectrum.data());
+
+  Energies energies;
+  const int maxBin = static_cast<int>(kMaxFrequency * kFFTSize / kSampleRate);
+  for (int k = 1; k <= maxBin; k++)
+  {
+    const double power = std::norm(spectrum[k]);
+    if (k % signal.grid)
+      energies.alias += power;
+    else if (std::find(signal.tones.begin(), signal.tones.end(), k) != signal.tones.end())
+      energies.tones += power;
+    else
+      energies.products += power;
+  }
+  return energies;
+}
+
+static Measurement MeasureConfig(const Config& config, EFilterType filterType, double threshold)
+{
+  static const std::vector<Signal> signals = MakeSignals();
+  SineWaveshaper shaper;
+  shaper.SetAlgorithm(config.algorithm);
+  shaper.SetSync(config.sync);
+  shaper.SetPull(config.pull);
+  shaper.SetDeform(config.deform);
+  shaper.SetStages(config.stages);
+  shaper.SetQuality(SineWaveshaper::kHigh);
+
+  Measurement result;
+  result.recommended = kNumFactors - 1;
+  for (int f = kNumFactors - 1; f >= 0; f--)
+  {
+    result.asr[f] = kFloorDB;
+    result.thdn[f] = kFloorDB;
+    for (const auto& signal : signals)
+    {
+      const auto energies = Measure(shaper, static_cast<EFactor>(f), filterType, signal, config.drive);
+      result.asr[f] = std::max(result.asr[f], PowerToDB(energies.alias / (energies.tones + energies.products)));
+      if (!strcmp(signal.name, "1kHz"))
+        result.thdn[f] = PowerToDB((energies.products + energies.alias) / energies.tones);
+    }
+  }
+  // Aliasing falls with the factor, but not strictly below the noise of the filters: the lowest factor from which on all pass
+  for (int f = kNumFactors - 1; f >= 0 && result.asr[f] <= threshold; f--)
+    result.recommended = f;
+  return result;
+}
+
+static bool WriteMap(const char* path, const std::vector<Measurement>& results, double threshold)
+{
+  FILE* file = fopen(path, "w");
+  if (!file)
+    return false;
+  fprintf(file, "#pragma once\n\n");
+  fprintf(file, "// Generated by tools/RCSinerAlias --map, do not edit. Threshold %g dB, Low Latency filters.\n", threshold);
+  fprintf(file, "// One EFactor per point of the grid in AliasMap.h, see aliasmap::GetIndex().\n\n");
+  fprintf(file, "#include <cstdint>\n\n");
+  fprintf(file, "namespace aliasmap\n{\n");
+  fprintf(file, "constexpr double kThreshold = %g; // dB\n\n", threshold);
+  fprintf(file, "constexpr uint8_t kFactors[] = {\n");
+  for (size_t i = 0; i < results.size(); i += aliasmap::kNumDrives * aliasmap::kNumStages)
+  {
+    fprintf(file, " ");
+    for (size_t j = i; j < std::min(results.size(), i + aliasmap::kNumDrives * aliasmap::kNumStages); j++)
+      fprintf(file, " %d,", results[j].recommended);
+    fprintf(file, "\n");
+  }
+  fprintf(file, "};\n");
+  fprintf(file, "} // namespace aliasmap\n");
+  fclose(file);
+  return true;
+}
+
+static void Usage()
+{
+  fprintf(stderr, "usage: RCSinerAlias [--algorithm N] [--sync A] [--pull B] [--deform C] [--stages N] [--drive DB] [--filter N] [--threshold DB]\n");
+  fprintf(stderr, "                    [--threads N] [--csv FILE] [--map FILE]\n");
+}
+
+int main(int argc, char* argv[])
+{
+  using namespace aliasmap;
+
+  int algorithm = -1;
+  double sync = -1., pull = -1., deform = -1., stages = -1., drive = -1.;
+  int filter = kHalfbandIIR;
+  double threshold = -60.;
+  int nThreads = 0;
+  const char* csvPath = nullptr;
+  const char* mapPath = nullptr;
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    if (i + 1 >= argc)
+    {
+      Usage();
+      return 1;
+    }
+    const char* value = argv[++i];
+    if (!strcmp(arg, "--algorithm"))
+      algorithm = atoi(value);
+    else if (!strcmp(arg, "--sync"))
+      sync = atof(value);
+    else if (!strcmp(arg, "--pull"))
+      pull = atof(value);
+    else if (!strcmp(arg, "--deform"))
+      deform = atof(value);
+    else if (!strcmp(arg, "--stages"))
+      stages = atof(value);
+    else if (!strcmp(arg, "--drive"))
+      drive = atof(value);
+    else if (!strcmp(arg, "--filter"))
+      filter = atoi(value);
+    else if (!strcmp(arg, "--threshold"))
+      threshold = atof(value);
+    else if (!strcmp(arg, "--threads"))
+      nThreads = atoi(value);
+    else if (!strcmp(arg, "--csv"))
+      csvPath = value;
+    else if (!strcmp(arg, "--map"))
+      mapPath = value;
+    else
+    {
+      Usage();
+      return 1;
+    }
+  }
+
+  if (algorithm >= SineWaveshaper::kNumAlgorithms || filter < 0 || filter >= kNumFilterTypes)
+  {
+    Usage();
+    return 1;
+  }
+  const bool fullGrid = algorithm < 0 && sync < 0. && pull < 0. && deform < 0. && stages < 0. && drive < 0.;
+  if (mapPath && (!fullGrid || filter != kHalfbandIIR))
+  {
+    fprintf(stderr, "--map needs the whole grid and the Low Latency filters\n");
+    return 1;
+  }
+
+  // Every fixed axis is a single point, the others run over the grid
+  auto axis = [](double value, const double* grid, int size) {
+    return value < 0. ? std::vector<double>(grid, grid + size) : std::vector<double>{value};
+  };
+  std::vector<int> algorithms;
+  for (int a = 0; a < SineWaveshaper::kNumAlgorithms; a++)
+    if (algorithm < 0 || a == algorithm)
+      algorithms.push_back(a);
+  const auto syncs = axis(sync, kSyncs, kNumSyncs);
+  const auto pulls = axis(pull, kPulls, kNumPulls);
+  const auto deforms = axis(deform, kDeforms, kNumDeforms);
+  const auto stageses = axis(stages, kStages, kNumStages);
+  const auto drives = axis(drive, kDrives, kNumDrives);
+
+  // Same order as aliasmap::GetIndex()
+  std::vector<Config> configs;
+  for (int a : algorithms)
+    for (double s : syncs)
+      for (double p : pulls)
+        for (double d : deforms)
+          for (double n : stageses)
+            for (double g : drives)
+              configs.push_back({a, s, p, d, n, g});
+
+  std::vector<Measurement> results(configs.size());
+  {
+    ThreadPool pool(nThreads);
+    fprintf(stderr, "measuring %d configurations on %d threads\n", static_cast<int>(configs.size()), pool.NThreads());
+    for (size_t i = 0; i < configs.size(); i++)
+      pool.Submit([&, i] { results[i] = MeasureConfig(configs[i], static_cast<EFilterType>(filter), threshold); });
+    pool.Wait();
+  }
+
+  printf("%-24s %6s %6s %6s %6s %6s", "algorithm", "sync", "pull", "deform", "stages", "drive");
+  for (const char* name : kFactorNames)
+    printf(" %7s", (std::string("ASR ") + name).c_str());
+  printf(" %9s %6s\n", "THD+N 1x", "factor");
+  for (size_t i = 0; i < configs.size(); i++)
+  {
+    const auto& config = configs[i];
+    const auto& result = results[i];
+    printf("%-24s %6g %6g %6g %6g %6g", SineWaveshaper::GetAlgorithmId(config.algorithm), config.sync, config.pull, config.deform, config.stages, config.drive);
+    for (int f = 0; f < kNumFactors; f++)
+      printf(" %7.1f", result.asr[f]);
+    printf(" %9.1f %6s%s\n", result.thdn[kNone], kFactorNames[result.recommended], result.asr[result.recommended] > threshold ? "!" : "");
+  }
+
+  if (csvPath)
+  {
+    FILE* file = fopen(csvPath, "w");
+    if (!file)
+    {
+      fprintf(stderr, "cannot write %s\n", csvPath);
+      return 1;
+    }
+    fprintf(file, "algorithm,sync,pull,deform,stages,drive");
+    for (const char* name : kFactorNames)
+      fprintf(file, ",asr_%s,thdn_%s", name, name);
+    fprintf(file, ",factor\n");
+    for (size_t i = 0; i < configs.size(); i++)
+    {
+      const auto& config = configs[i];
+      fprintf(file, "%s,%g,%g,%g,%g,%g", SineWaveshaper::GetAlgorithmId(config.algorithm), config.sync, config.pull, config.deform, config.stages, config.drive);
+      for (int f = 0; f < kNumFactors; f++)
+        fprintf(file, ",%.2f,%.2f", results[i].asr[f], results[i].thdn[f]);
+      fprintf(file, ",%s\n", kFactorNames[results[i].recommended]);
+    }
+    fclose(file);
+  }
+
+  if (mapPath && !WriteMap(mapPath, results, threshold))
+  {
+    fprintf(stderr, "cannot write %s\n", mapPath);
+    return 1;
+  }
+  return 0;
+}
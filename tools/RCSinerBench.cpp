@@ -0,0 +1,316 @@
+/*
+ Headless CPU benchmark suite of the RCSiner DSP, in the spirit of Google Benchmark.
+ Every benchmark repeats its work until --min-time has passed, the fastest of three repetitions is reported as ns/sample and samples/s.
+
+ Suites:
+   ProcessSample/<algorithm>/stages:N    SineWaveshaper::ProcessSample, stages 1-8
+   ProcessBlock/<algorithm>/stages:N     SineWaveshaper::ProcessBlock, stages 1-8, also in single precision (/f32) and with the Eco quality (/eco),
+                                         the Exact quality costs the same as ProcessSample
+   BlockOverSampler/<factor>/block:N/ch:C  up and down sampling around a copy, block sizes 32-4096, mono and stereo, stereo also with
+                                           the scalar half-band filters (/fpu), the linear phase filters (/fir) and in single precision (/f32)
+   AntiAlias/<mode>                     ADAA against oversampling at 48kHz, also reported as CPU per channel
+   Denormals/<factor>/<mode>            stereo oversampling and shaping of input decaying through the denormal range, as after the transport
+                                        stops, with the default floating point mode and with ScopedFlushDenormals (ftz)
+
+ usage: RCSinerBench [--filter TEXT] [--min-time S] [--sync A] [--csv FILE] [--compare FILE] [--tolerance PCT]
+   --filter     only run benchmarks whose name contains TEXT
+   --csv        write the results, to be used as a baseline
+   --compare    compare against a baseline written with --csv, exits with 1 when a benchmark is slower by more than --tolerance percent (default 10)
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "BlockOversampler.h"
+#include "SineWaveshaper.h"
+#include "TransferCurveTable.h"
+
+using namespace iplug;
+
+static constexpr double kSampleRate = 48000.;
+static constexpr int kBufferSize = 4096;
+static constexpr int kNumRepetitions = 3;
+
+static const char* kFactorNames[] = {"1x", "2x", "4x", "8x", "16x"};
+
+struct Benchmark
+{
+  std::string name;
+  int64_t samplesPerIteration;
+  std::function<void()> iteration;
+};
+
+struct Result
+{
+  std::string name;
+  double nsPerSample;
+};
+
+static Result Run(const Benchmark& benchmark, double minTime)
+{
+  using Clock = std::chrono::steady_clock;
+  benchmark.iteration();
+
+  double best = 1e300;
+  for (int rep = 0; rep < kNumRepetitions; rep++)
+  {
+    int64_t iterations = 0;
+    const auto start = Clock::now();
+    double elapsed = 0.;
+    // Iterations are added in growing batches so the clock is read rarely
+    for (int64_t batch = 1; elapsed < minTime; batch *= 2)
+    {
+      for (int64_t i = 0; i < batch; i++)
+        benchmark.iteration();
+      iterations += batch;
+      elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    }
+    best = std::min(best, elapsed * 1e9 / (iterations * benchmark.samplesPerIteration));
+  }
+  return {benchmark.name, best};
+}
+
+static std::map<std::string, double> LoadBaseline(const char* path)
+{
+  std::map<std::string, double> baseline;
+  if (FILE* file = fopen(path, "r"))
+  {
+    char name[256];
+    double nsPerSample;
+    while (fscanf(file, "%255[^,],%lf\n", name, &nsPerSample) == 2)
+      baseline[name] = nsPerSample;
+    fclose(file);
+  }
+  return baseline;
+}
+
+int main(int argc, char* argv[])
+{
+  const char* filter = "";
+  const char* csvPath = nullptr;
+  const char* comparePath = nullptr;
+  double minTime = .1;
+  double sync = 2.;
+  double tolerance = 10.;
+
+  for (int i = 1; i + 1 < argc; i += 2)
+  {
+    if (!strcmp(argv[i], "--filter"))
+      filter = argv[i + 1];
+    else if (!strcmp(argv[i], "--min-time"))
+      minTime = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--sync"))
+      sync = atof(argv[i + 1]);
+    else if (!strcmp(argv[i], "--csv"))
+      csvPath = argv[i + 1];
+    else if (!strcmp(argv[i], "--compare"))
+      comparePath = argv[i + 1];
+    else if (!strcmp(argv[i], "--tolerance"))
+      tolerance = atof(argv[i + 1]);
+    else
+    {
+      fprintf(stderr, "unknown option %s\n", argv[i]);
+      return 1;
+    }
+  }
+
+  std::vector<sample> input(kBufferSize * 2);
+  std::vector<sample> output(input.size());
+  for (size_t s = 0; s < input.size(); s++)
+    input[s] = .9 * std::sin(2. * PI * 1000. * s / kSampleRate);
+  sample* inputs[2] = {input.data(), input.data() + kBufferSize};
+  sample* outputs[2] = {output.data(), output.data() + kBufferSize};
+  std::vector<float> inputF(input.begin(), input.end());
+  std::vector<float> outputF(input.size());
+  float* inputsF[2] = {inputF.data(), inputF.data() + kBufferSize};
+  float* outputsF[2] = {outputF.data(), outputF.data() + kBufferSize};
+  volatile sample sink = 0.;
+
+  // Everything the benchmarks capture lives here, so the closures stay valid until the end
+  SineWaveshaper shaper;
+  shaper.SetSync(sync);
+  TransferCurveTable table;
+  TransferCurveTable::ADAAState adaaState;
+  std::vector<std::unique_ptr<SineWaveshaper>> shapers;
+  std::vector<std::unique_ptr<BlockOverSampler<sample>>> overSamplers;
+  std::vector<std::unique_ptr<BlockOverSampler<float>>> overSamplersF;
+  std::vector<Benchmark> benchmarks;
+
+  for (int algorithm = 0; algorithm < SineWaveshaper::kNumAlgorithms; algorithm++)
+  {
+    for (int stages = 1; stages <= 8; stages++)
+    {
+      shapers.emplace_back(new SineWaveshaper);
+      SineWaveshaper& ws = *shapers.back();
+      ws.SetAlgorithm(algorithm);
+      ws.SetSync(sync);
+      ws.SetStages(stages);
+      const std::string args = std::string(SineWaveshaper::GetAlgorithmId(algorithm)) + "/stages:" + std::to_string(stages);
+      benchmarks.push_back({"ProcessSample/" + args, kBufferSize, [&, pWs = &ws]() {
+                              sample sum = 0.;
+                              for (int s = 0; s < kBufferSize; s++)
+                                sum += pWs->ProcessSample(inputs[0][s]);
+                              sink = sum;
+                            }});
+      benchmarks.push_back({"ProcessBlock/" + args, kBufferSize, [&, pWs = &ws]() { pWs->ProcessBlock(inputs[0], outputs[0], kBufferSize); }});
+      benchmarks.push_back({"ProcessBlock/" + args + "/f32", kBufferSize, [&, pWs = &ws]() { pWs->ProcessBlock(inputsF[0], outputsF[0], kBufferSize); }});
+
+      shapers.emplace_back(new SineWaveshaper(ws));
+      SineWaveshaper& eco = *shapers.back();
+      eco.SetQuality(SineWaveshaper::kEco);
+      benchmarks.push_back({"ProcessBlock/" + args + "/eco", kBufferSize, [&, pWs = &eco]() { pWs->ProcessBlock(inputs[0], outputs[0], kBufferSize); }});
+      benchmarks.push_back({"ProcessBlock/" + args + "/eco/f32", kBufferSize, [&, pWs = &eco]() { pWs->ProcessBlock(inputsF[0], outputsF[0], kBufferSize); }});
+    }
+  }
+
+  for (int factor = EFactor::kNone; factor < EFactor::kNumFactors; factor++)
+  {
+    for (int blockSize = 32; blockSize <= kBufferSize; blockSize *= 2)
+    {
+      // ch:2/fpu forces the scalar half-band filters, to compare against the vectorised stereo path, ch:2/fir uses the linear phase filters
+      for (int variant = 0; variant < 4; variant++)
+      {
+        static const char* kVariantSuffixes[] = {"", "", "/fpu", "/fir"};
+        const int nChans = variant ? 2 : 1;
+        const EFilterType filterType = variant == 3 ? kLinearPhaseFIR : kHalfbandIIR;
+        overSamplers.emplace_back(new BlockOverSampler<sample>(static_cast<EFactor>(factor), nChans, nChans, blockSize, variant != 2, filterType));
+        auto* pOverSampler = overSamplers.back().get();
+        const std::string name = std::string("BlockOverSampler/") + kFactorNames[factor] + "/block:" + std::to_string(blockSize) + "/ch:" + std::to_string(nChans) + kVariantSuffixes[variant];
+        benchmarks.push_back({name, static_cast<int64_t>(kBufferSize) * nChans, [&, pOverSampler, blockSize, nChans]() {
+                                auto copy = [nChans](sample** in, sample** out, int nFrames) {
+                                  for (int c = 0; c < nChans; c++)
+                                    std::copy(in[c], in[c] + nFrames, out[c]);
+                                };
+                                for (int pos = 0; pos < kBufferSize; pos += blockSize)
+                                {
+                                  sample* in[2] = {inputs[0] + pos, inputs[1] + pos};
+                                  sample* out[2] = {outputs[0] + pos, outputs[1] + pos};
+                                  pOverSampler->ProcessBlock(in, out, blockSize, nChans, nChans, copy);
+                                }
+                              }});
+      }
+
+      overSamplersF.emplace_back(new BlockOverSampler<float>(static_cast<EFactor>(factor), 2, 2, blockSize));
+      auto* pOverSamplerF = overSamplersF.back().get();
+      const std::string name = std::string("BlockOverSampler/") + kFactorNames[factor] + "/block:" + std::to_string(blockSize) + "/ch:2/f32";
+      benchmarks.push_back({name, static_cast<int64_t>(kBufferSize) * 2, [&, pOverSamplerF, blockSize]() {
+                              auto copy = [](float** in, float** out, int nFrames) {
+                                for (int c = 0; c < 2; c++)
+                                  std::copy(in[c], in[c] + nFrames, out[c]);
+                              };
+                              for (int pos = 0; pos < kBufferSize; pos += blockSize)
+                              {
+                                float* in[2] = {inputsF[0] + pos, inputsF[1] + pos};
+                                float* out[2] = {outputsF[0] + pos, outputsF[1] + pos};
+                                pOverSamplerF->ProcessBlock(in, out, blockSize, 2, 2, copy);
+                              }
+                            }});
+    }
+  }
+
+  // The anti-aliasing options at the plugin's default block size, the shaper runs inside the oversampler
+  table.Build(shaper, 0);
+  table.Acquire(0);
+  auto exact = [&](sample** in, sample** out, int nFrames) { shaper.ProcessBlock(in[0], out[0], nFrames); };
+  auto adaa1 = [&](sample** in, sample** out, int nFrames) { table.ProcessBlockADAA(1, shaper, in[0], out[0], nFrames, adaaState); };
+  auto adaa2 = [&](sample** in, sample** out, int nFrames) { table.ProcessBlockADAA(2, shaper, in[0], out[0], nFrames, adaaState); };
+  auto addAntiAlias = [&](const char* mode, EFactor factor, auto func) {
+    overSamplers.emplace_back(new BlockOverSampler<sample>(factor, 1, 1, 512));
+    auto* pOverSampler = overSamplers.back().get();
+    benchmarks.push_back({std::string("AntiAlias/") + mode, kBufferSize, [&, pOverSampler, func]() {
+                            for (int pos = 0; pos < kBufferSize; pos += 512)
+                            {
+                              sample* in = inputs[0] + pos;
+                              sample* out = outputs[0] + pos;
+                              pOverSampler->ProcessBlock(&in, &out, 512, 1, 1, func);
+                            }
+                          }});
+  };
+  addAntiAlias("1x", EFactor::kNone, exact);
+  addAntiAlias("1x_ADAA", EFactor::kNone, adaa1);
+  addAntiAlias("1x_ADAA2", EFactor::kNone, adaa2);
+  addAntiAlias("2x_ADAA", EFactor::k2x, adaa1);
+  for (int factor = EFactor::k2x; factor < EFactor::kNumFactors; factor++)
+    addAntiAlias(kFactorNames[factor], static_cast<EFactor>(factor), exact);
+
+  // From 1e-300 down to 1e-320, where the filter states and the shaper are deep in the denormal range
+  std::vector<sample> decaying(kBufferSize * 2);
+  for (size_t s = 0; s < decaying.size(); s++)
+    decaying[s] = 1e-300 * std::pow(1e-20, static_cast<double>(s % kBufferSize) / kBufferSize) * std::sin(2. * PI * 1000. * s / kSampleRate);
+  sample* decayingInputs[2] = {decaying.data(), decaying.data() + kBufferSize};
+  for (EFactor factor : {EFactor::kNone, EFactor::k2x, EFactor::k8x})
+  {
+    for (bool flush : {false, true})
+    {
+      overSamplers.emplace_back(new BlockOverSampler<sample>(factor, 2, 2, 512));
+      auto* pOverSampler = overSamplers.back().get();
+      const std::string name = std::string("Denormals/") + kFactorNames[factor] + (flush ? "/ftz" : "/default");
+      benchmarks.push_back({name, static_cast<int64_t>(kBufferSize) * 2, [&, pOverSampler, flush]() {
+                              auto shape = [&](sample** in, sample** out, int nFrames) {
+                                for (int c = 0; c < 2; c++)
+                                  shaper.ProcessBlock(in[c], out[c], nFrames);
+                              };
+                              auto process = [&]() {
+                                for (int pos = 0; pos < kBufferSize; pos += 512)
+                                {
+                                  sample* in[2] = {decayingInputs[0] + pos, decayingInputs[1] + pos};
+                                  sample* out[2] = {outputs[0] + pos, outputs[1] + pos};
+                                  pOverSampler->ProcessBlock(in, out, 512, 2, 2, shape);
+                                }
+                              };
+                              if (flush)
+                              {
+                                const simd::ScopedFlushDenormals flushDenormals;
+                                process();
+                              }
+                              else
+                                process();
+                            }});
+    }
+  }
+
+  const auto baseline = comparePath ? LoadBaseline(comparePath) : std::map<std::string, double>();
+  FILE* csv = csvPath ? fopen(csvPath, "w") : nullptr;
+  if (csvPath && !csv)
+  {
+    fprintf(stderr, "cannot create %s\n", csvPath);
+    return 1;
+  }
+
+  printf("%-48s %12s %14s %10s\n", "Benchmark", "ns/sample", "samples/s", comparePath ? "vs base" : "");
+  int regressions = 0;
+  for (const auto& benchmark : benchmarks)
+  {
+    if (benchmark.name.find(filter) == std::string::npos)
+      continue;
+    const Result result = Run(benchmark, minTime);
+    printf("%-48s %12.3f %14.4g", result.name.c_str(), result.nsPerSample, 1e9 / result.nsPerSample);
+    if (benchmark.name.compare(0, 10, "AntiAlias/") == 0)
+      printf("  %.3f%% CPU/channel @48kHz", result.nsPerSample * kSampleRate * 1e-7);
+    const auto base = baseline.find(result.name);
+    if (base != baseline.end())
+    {
+      const double change = (result.nsPerSample / base->second - 1.) * 100.;
+      const bool regressed = change > tolerance;
+      regressions += regressed;
+      printf(" %+9.1f%%%s", change, regressed ? " REGRESSION" : "");
+    }
+    printf("\n");
+    if (csv)
+      fprintf(csv, "%s,%.6f\n", result.name.c_str(), result.nsPerSample);
+  }
+
+  if (csv)
+    fclose(csv);
+  if (regressions)
+    printf("%d benchmark(s) slower than the baseline by more than %g%%\n", regressions, tolerance);
+  return regressions ? 1 : 0;
+}
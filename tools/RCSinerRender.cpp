@@ -0,0 +1,442 @@
+/*
+ Headless offline renderer, runs the RCSiner signal chain over a file without a plugin host.
+ Input and output are streamed in fixed-size chunks, so memory use does not depend on the file length.
+ Renders always count as offline, so the "OverSample (Render)" and "Quality (Render)" settings apply. The latency of the oversampling filters and the whole
+ samples of the ADAA delay is compensated, the output lines up with the input to within the half sample 1st order ADAA delays by
+ without oversampling, and has the same length.
+
+ With --threads the file is cut into segments that render in parallel. The oversampling filters (the linear phase ones also delay by their
+ latency), ADAA and the count of silent input that bypasses processing carry state from one sample to the next, so every segment first
+ processes a pre-roll of the preceding input which is then discarded. By default the pre-roll covers the tail size of the settings.
+ The state after the pre-roll matches the serial render to far below the resolution of the 32 bit output, but not sample for sample.
+ Auto oversampling depends on the whole preceding input through its hold time and crossfades, so it always renders serially.
+ A serial render of a multichannel file can instead process groups of channels in parallel with --channel-threads, which matches the serial
+ render exactly.
+
+ usage: RCSinerRender [options] input output
+   input            WAV (PCM 16/24/32 bit or float) or raw interleaved float32 (needs --raw)
+   output           32 bit float, WAV unless the input is raw
+   --raw CH RATE    treat the input as raw float32 with CH channels at RATE Hz
+   --state FILE     load the parameters from a state chunk saved by the plugin
+   --chunk N        frames per chunk, default 4096
+   --threads N      render segments on N threads, 0 uses all cores, default 1 (serial)
+   --channel-threads N  with --threads 1, process the channel groups on N threads, 0 uses all cores, default 1
+   --segment S      segment length in seconds, default 4
+   --preroll N      pre-roll frames per segment, default the tail size of the settings but at least 8192
+   --<param> VALUE  set a parameter, in the units shown by the plugin (see --help)
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "AudioFile.h"
+#include "RCSinerDSP.h"
+#include "RCSinerParams.h"
+#include "ThreadPool.h"
+
+using namespace iplug;
+
+static constexpr int kMaxChannels = 64;
+static constexpr int kMinPreroll = 8192; // frames, unless set with --preroll
+
+struct ParamOption
+{
+  const char* name;
+  int idx;
+  double defaultValue;
+};
+
+// Mirrors the parameter defaults in RCSiner.cpp. Enums take their index.
+static constexpr ParamOption kParamOptions[] = {
+  {"algorithm", kAlgorithm, 0.},
+  {"sync", kSync, 1.},
+  {"pull", kPull, 1.},
+  {"deform", kDeform, 1.},
+  {"stages", kStages, 1.},
+  {"pre-clip", kPreClip, 0.},
+  {"post-clip", kPostClip, 0.},
+  {"input-gain", kInputGain, 0.},
+  {"output-gain", kOutputGain, -6.},
+  {"wetness", kWetness, 100.},
+  {"oversample", kOverSample, 0.},
+  {"oversample-online", kOverSampleOnline, 0.},
+  {"oversample-offline", kOverSampleOffline, 0.},
+  {"curve-table", kCurveTable, 0.},
+  {"anti-alias", kAntiAlias, 0.},
+  {"oversample-filter", kOverSampleFilter, 0.},
+  {"silence-threshold", kSilenceThreshold, -120.},
+  {"precision", kPrecision, 0.},
+  {"quality", kQuality, 1.},
+  {"quality-offline", kQualityOffline, 0.},
+};
+static_assert(sizeof(kParamOptions) / sizeof(kParamOptions[0]) == kNumParams, "every parameter needs an option");
+
+static void PrintUsage()
+{
+  fprintf(stderr, "usage: RCSinerRender [--raw CH RATE] [--state FILE] [--chunk N] [--threads N] [--channel-threads N] [--segment S] [--preroll N] [--<param> VALUE]... input output\nparameters:");
+  for (const auto& option : kParamOptions)
+    fprintf(stderr, " --%s", option.name);
+  fprintf(stderr, "\n");
+}
+
+// The plugin state is iPlug's chunk: the optional header of IByteChunk::InitChunkWithIPlugVer(), then the parameter values in index order as
+// IPluginBase::SerializeParams() writes them, one double each
+static bool LoadState(const char* path, double* values)
+{
+  static constexpr int kIPlugVerMagic = static_cast<int>(0xfefefefe);
+  FILE* file = fopen(path, "rb");
+  if (!file)
+    return false;
+  int header[2];
+  bool read = fread(header, sizeof(int), 2, file) == 2;
+  if (read && header[0] != kIPlugVerMagic)
+    read = !fseek(file, 0, SEEK_SET);
+  double state[kNumParams];
+  read = read && fread(state, sizeof(double), kNumParams, file) == kNumParams;
+  fclose(file);
+  if (read)
+    std::copy(std::begin(state), std::end(state), values);
+  return read;
+}
+
+static void ConfigureWaveshaper(SineWaveshaper& shaper, const double* values)
+{
+  shaper.SetAlgorithm(static_cast<int>(values[kAlgorithm]));
+  shaper.SetSync(values[kSync]);
+  shaper.SetPull(values[kPull]);
+  shaper.SetDeform(values[kDeform]);
+  shaper.SetStages(values[kStages]);
+  shaper.SetPreClip(values[kPreClip] > .5);
+  shaper.SetPostClip(values[kPostClip] > .5);
+}
+
+static void Configure(RCSinerDSP& dsp, const double* values)
+{
+  SineWaveshaper shaper;
+  ConfigureWaveshaper(shaper, values);
+  dsp.SetShaper(shaper);
+  if (values[kCurveTable] > 0. || values[kAntiAlias] > 0.)
+    dsp.UpdateCurveTable(shaper, dsp.GetShaperVersion());
+  dsp.SetSync(values[kSync]);
+  dsp.SetPull(values[kPull]);
+  dsp.SetDeform(values[kDeform]);
+  dsp.SetStages(values[kStages]);
+  dsp.SetInputGain(values[kInputGain]);
+  dsp.SetOutputGain(values[kOutputGain]);
+  dsp.SetWetness(values[kWetness]);
+  dsp.SetCurveTable(static_cast<int>(values[kCurveTable]));
+  dsp.SetAntiAlias(static_cast<int>(values[kAntiAlias]));
+  dsp.SetOverSampling(GetOverSamplingFactor(values[kOverSample] > .5, static_cast<int>(values[kOverSampleOnline]), static_cast<int>(values[kOverSampleOffline]), true));
+  dsp.SetAutoOverSampling(IsOverSamplingAuto(values[kOverSample] > .5, static_cast<int>(values[kOverSampleOnline]), static_cast<int>(values[kOverSampleOffline]), true));
+  dsp.SetOverSamplingFilter(static_cast<iplug::EFilterType>(values[kOverSampleFilter]));
+  dsp.SetSilenceThreshold(values[kSilenceThreshold]);
+  dsp.SetSinglePrecision(values[kPrecision] > .5);
+  // The factor of a render is fixed, only Auto changes it
+  dsp.Prepare(values[kPrecision] > .5, IsOverSamplingAuto(values[kOverSample] > .5, static_cast<int>(values[kOverSampleOnline]), static_cast<int>(values[kOverSampleOffline]), true));
+  dsp.SetQuality(GetShaperQuality(static_cast<int>(values[kQuality]), static_cast<int>(values[kQualityOffline]), true));
+}
+
+// Processes interleaved audio in place, chunkSize frames at a time
+static void ProcessInterleaved(RCSinerDSP& dsp, double* interleaved, int64_t nFrames, int chunkSize, std::vector<sample>& scratch)
+{
+  // Like the plugin, so renders match it and don't slow down on denormals
+  const simd::ScopedFlushDenormals flushDenormals;
+  const int nChans = dsp.NChannels();
+  scratch.resize(static_cast<size_t>(chunkSize) * nChans);
+  sample* channels[kMaxChannels];
+  for (int c = 0; c < nChans; c++)
+    channels[c] = scratch.data() + c * chunkSize;
+
+  for (int64_t pos = 0; pos < nFrames; pos += chunkSize)
+  {
+    const int n = static_cast<int>(std::min<int64_t>(chunkSize, nFrames - pos));
+    double* frames = interleaved + pos * nChans;
+    for (int s = 0; s < n; s++)
+      for (int c = 0; c < nChans; c++)
+        channels[c][s] = frames[s * nChans + c];
+
+    dsp.ProcessBlock(channels, channels, n, nChans);
+
+    for (int s = 0; s < n; s++)
+      for (int c = 0; c < nChans; c++)
+        frames[s * nChans + c] = channels[c][s];
+  }
+}
+
+struct Segment
+{
+  std::vector<double> data; // interleaved, the pre-roll followed by the frames to keep
+  int preroll = 0;
+  int nFrames = 0;
+  bool done = false;
+};
+
+int main(int argc, char* argv[])
+{
+  double values[kNumParams];
+  for (const auto& option : kParamOptions)
+    values[option.idx] = option.defaultValue;
+
+  const char* paths[2] = {};
+  int nPaths = 0;
+  int rawChannels = 0;
+  double rawSampleRate = 0.;
+  int chunkSize = 4096;
+  int nThreads = 1;
+  int nChannelThreads = 1;
+  double segmentSeconds = 4.;
+  int prerollFrames = -1; // from the tail size
+
+  for (int i = 1; i < argc; i++)
+  {
+    const char* arg = argv[i];
+    if (!strcmp(arg, "--help") || !strcmp(arg, "-h"))
+    {
+      PrintUsage();
+      return 0;
+    }
+    if (strncmp(arg, "--", 2))
+    {
+      if (nPaths == 2)
+      {
+        PrintUsage();
+        return 1;
+      }
+      paths[nPaths++] = arg;
+      continue;
+    }
+    if (!strcmp(arg, "--raw") && i + 2 < argc)
+    {
+      rawChannels = atoi(argv[++i]);
+      rawSampleRate = atof(argv[++i]);
+      continue;
+    }
+    if (i + 1 >= argc)
+    {
+      PrintUsage();
+      return 1;
+    }
+    const char* value = argv[++i];
+    if (!strcmp(arg, "--state"))
+    {
+      if (!LoadState(value, values))
+      {
+        fprintf(stderr, "cannot read state %s\n", value);
+        return 1;
+      }
+      continue;
+    }
+    if (!strcmp(arg, "--chunk"))
+    {
+      chunkSize = std::max(atoi(value), 1);
+      continue;
+    }
+    if (!strcmp(arg, "--threads"))
+    {
+      nThreads = atoi(value);
+      continue;
+    }
+    if (!strcmp(arg, "--channel-threads"))
+    {
+      nChannelThreads = atoi(value);
+      continue;
+    }
+    if (!strcmp(arg, "--segment"))
+    {
+      segmentSeconds = atof(value);
+      continue;
+    }
+    if (!strcmp(arg, "--preroll"))
+    {
+      prerollFrames = std::max(atoi(value), 0);
+      continue;
+    }
+    bool found = false;
+    for (const auto& option : kParamOptions)
+    {
+      if (!strcmp(arg + 2, option.name))
+      {
+        values[option.idx] = atof(value);
+        found = true;
+      }
+    }
+    if (!found)
+    {
+      fprintf(stderr, "unknown option %s\n", arg);
+      PrintUsage();
+      return 1;
+    }
+  }
+
+  if (nPaths != 2)
+  {
+    PrintUsage();
+    return 1;
+  }
+
+  AudioFileReader reader;
+  const bool opened = rawChannels > 0 ? reader.OpenRaw(paths[0], rawChannels, rawSampleRate) : reader.OpenWav(paths[0]);
+  if (!opened)
+  {
+    fprintf(stderr, "%s: %s\n", paths[0], reader.GetError().c_str());
+    return 1;
+  }
+  const int nChans = reader.NChannels();
+  const double sampleRate = reader.GetSampleRate();
+  if (nChans > kMaxChannels)
+  {
+    fprintf(stderr, "%s: more than %d channels\n", paths[0], kMaxChannels);
+    return 1;
+  }
+
+  AudioFileWriter writer;
+  if (!writer.Open(paths[1], nChans, sampleRate, rawChannels == 0))
+  {
+    fprintf(stderr, "%s: cannot create file\n", paths[1]);
+    return 1;
+  }
+
+  using Clock = std::chrono::steady_clock;
+  const auto start = Clock::now();
+  double fileSeconds = 0.; // reading and writing, on this thread
+  int64_t totalFrames = 0;
+  std::vector<sample> scratch;
+
+  // The latency is compensated like a host would: the first output frames are dropped and the input is followed by as much silence
+  int latency;
+  {
+    RCSinerDSP dsp(nChans, 1, sampleRate);
+    Configure(dsp, values);
+    latency = dsp.GetLatency();
+    if (prerollFrames < 0)
+      prerollFrames = std::max(kMinPreroll, dsp.GetTailSize());
+  }
+  if (nThreads != 1 && IsOverSamplingAuto(values[kOverSample] > .5, static_cast<int>(values[kOverSampleOnline]), static_cast<int>(values[kOverSampleOffline]), true))
+  {
+    fprintf(stderr, "Auto oversampling can't render in segments, rendering serially\n");
+    nThreads = 1;
+  }
+  int64_t tailFrames = latency;
+  int64_t skipFrames = latency;
+  auto readInput = [&](double* interleaved, int maxFrames) {
+    const auto readStart = Clock::now();
+    int nFrames = reader.Read(interleaved, maxFrames);
+    fileSeconds += std::chrono::duration<double>(Clock::now() - readStart).count();
+    const int nTail = static_cast<int>(std::min<int64_t>(tailFrames, maxFrames - nFrames));
+    std::fill_n(interleaved + static_cast<size_t>(nFrames) * nChans, static_cast<size_t>(nTail) * nChans, 0.);
+    tailFrames -= nTail;
+    return nFrames + nTail;
+  };
+  auto writeOutput = [&](const double* interleaved, int nFrames) {
+    const int nSkip = static_cast<int>(std::min<int64_t>(skipFrames, nFrames));
+    skipFrames -= nSkip;
+    totalFrames += nFrames - nSkip;
+    const auto writeStart = Clock::now();
+    const bool written = writer.Write(interleaved + static_cast<size_t>(nSkip) * nChans, nFrames - nSkip);
+    fileSeconds += std::chrono::duration<double>(Clock::now() - writeStart).count();
+    return written;
+  };
+
+  if (nThreads == 1)
+  {
+    RCSinerDSP dsp(nChans, chunkSize, sampleRate);
+    Configure(dsp, values);
+    dsp.SetThreads(nChannelThreads);
+    dsp.SetThreadsEnabled(true);
+    nThreads = dsp.GetThreads();
+    std::vector<double> interleaved(static_cast<size_t>(chunkSize) * nChans);
+    int nFrames;
+    while ((nFrames = readInput(interleaved.data(), chunkSize)) > 0)
+    {
+      ProcessInterleaved(dsp, interleaved.data(), nFrames, chunkSize, scratch);
+      if (!writeOutput(interleaved.data(), nFrames))
+      {
+        fprintf(stderr, "%s: write failed\n", paths[1]);
+        return 1;
+      }
+    }
+  }
+  else
+  {
+    // This thread reads and writes in order while the pool renders, at most two segments per thread are in flight
+    ThreadPool pool(nThreads);
+    nThreads = pool.NThreads();
+    const int segmentFrames = std::max(1, static_cast<int>(segmentSeconds * sampleRate));
+    std::deque<std::unique_ptr<Segment>> inFlight;
+    std::vector<double> history; // the input preceding the next segment, up to prerollFrames
+    std::mutex doneMutex;
+    std::condition_variable doneCondition;
+
+    auto writeOldest = [&]() {
+      Segment& segment = *inFlight.front();
+      {
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCondition.wait(lock, [&] { return segment.done; });
+      }
+      const bool written = writeOutput(segment.data.data() + static_cast<size_t>(segment.preroll) * nChans, segment.nFrames);
+      inFlight.pop_front();
+      return written;
+    };
+
+    bool failed = false;
+    while (!failed)
+    {
+      auto segment = std::make_unique<Segment>();
+      segment->preroll = static_cast<int>(history.size() / nChans);
+      segment->data = history;
+      segment->data.resize(static_cast<size_t>(segment->preroll + segmentFrames) * nChans);
+      segment->nFrames = readInput(segment->data.data() + history.size(), segmentFrames);
+      if (!segment->nFrames)
+        break;
+      segment->data.resize(static_cast<size_t>(segment->preroll + segment->nFrames) * nChans);
+
+      const size_t historySamples = std::min(segment->data.size(), static_cast<size_t>(prerollFrames) * nChans);
+      history.assign(segment->data.end() - historySamples, segment->data.end());
+
+      pool.Submit([&, pSegment = segment.get()]() {
+        RCSinerDSP dsp(nChans, chunkSize, sampleRate);
+        Configure(dsp, values);
+        std::vector<sample> taskScratch;
+        ProcessInterleaved(dsp, pSegment->data.data(), pSegment->preroll + pSegment->nFrames, chunkSize, taskScratch);
+        {
+          std::lock_guard<std::mutex> lock(doneMutex);
+          pSegment->done = true;
+        }
+        doneCondition.notify_all();
+      });
+      inFlight.push_back(std::move(segment));
+
+      while (!failed && static_cast<int>(inFlight.size()) >= 2 * nThreads)
+        failed = !writeOldest();
+    }
+    while (!failed && !inFlight.empty())
+      failed = !writeOldest();
+    pool.Wait();
+
+    if (failed)
+    {
+      fprintf(stderr, "%s: write failed\n", paths[1]);
+      return 1;
+    }
+  }
+  const auto closeStart = Clock::now();
+  writer.Close();
+  fileSeconds += std::chrono::duration<double>(Clock::now() - closeStart).count();
+
+  const double total = std::chrono::duration<double>(Clock::now() - start).count();
+  const double processing = total - fileSeconds;
+  const double audio = totalFrames / sampleRate;
+  printf("Rendered %.2f s of %d channel audio on %d thread(s)\n", audio, nChans, nThreads);
+  printf("Wall time %.3f s, %.1fx realtime\n", total, audio / total);
+  printf("Processing %.3f s without file I/O, %.1fx realtime\n", processing, audio / processing);
+  return 0;
+}